@@ -0,0 +1,62 @@
+#include "autoimporter.h"
+
+#include <QtDebug>
+#include <utility>
+
+using namespace CamWatcher;
+
+AutoImporter::AutoImporter(UsbManager& usb, QString defaultDestPath, const Mode defaultMode)
+    : mUsb(usb), mDefaultDestPath(std::move(defaultDestPath)), mDefaultMode(defaultMode) {
+    connect(&mUsb, &UsbManager::deviceListed, this, &AutoImporter::onDeviceListed);
+    connect(&mUsb, &UsbManager::deviceAboutToBeRemoved, this, &AutoImporter::onDeviceAboutToBeRemoved);
+}
+
+void AutoImporter::onDeviceListed(UsbDevice* dev) {
+    // The Idle state from the listing is applied through the main thread queue, after this signal. A camera seen for
+    // the first time is still in Init then.
+    if (mStarted.contains(dev) || (dev->state() != UsbDevice::Idle && dev->state() != UsbDevice::Init))
+        return;
+
+    const auto mode = this->mode(*dev);
+    if (mode == Off) {
+        qInfo() << dev->name() << "is not imported automatically";
+        return;
+    }
+    if (dev->newFileCount() == 0) {
+        qInfo() << dev->name() << "has nothing new to import";
+        return;
+    }
+
+    if (dev->destFilePath().isEmpty()) {
+        if (mDefaultDestPath.isEmpty()) {
+            qWarning() << dev->name() << "has no destination, set one in the gui or pass --dest";
+            return;
+        }
+        dev->setDestFilePath(mDefaultDestPath);
+    }
+
+    mStarted.insert(dev);
+    connect(dev, &UsbDevice::stateChanged, this, [dev](const UsbDevice::State state, const StateParm& parm) {
+        if (state == UsbDevice::Done || state == UsbDevice::Error)
+            qInfo().noquote() << dev->name() << "import finished:" << parm.toString();
+    });
+
+    qInfo().noquote() << (mode == Move ? "Moving" : "Copying") << dev->newFileCount() << "files from" << dev->name()
+                      << "to" << dev->destFilePath();
+    mUsb.downloadFiles(*dev, mode == Move);
+}
+
+void AutoImporter::onDeviceAboutToBeRemoved(UsbDevice* dev) {
+    mStarted.remove(dev);
+}
+
+AutoImporter::Mode AutoImporter::mode(const UsbDevice& dev) const {
+    const auto value = dev.autoImport();
+    if (value == "copy")
+        return Copy;
+    if (value == "move")
+        return Move;
+    if (value == "off")
+        return Off;
+    return mDefaultMode;
+}
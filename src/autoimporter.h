@@ -0,0 +1,37 @@
+#pragma once
+
+#include "usbdevice.h"
+#include "usbmanager.h"
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+namespace CamWatcher {
+
+    /**
+     * Imports from every camera as soon as its files are listed, for running without anyone at the screen.
+     * Each camera goes to its own destination and backups as set up in the gui, a camera without one goes to the
+     * default destination. A camera is imported once per connection and only when it has files not imported yet.
+     */
+    class AutoImporter final : public QObject {
+        Q_OBJECT
+    public:
+        enum Mode { Off, Copy, Move };
+
+        AutoImporter(UsbManager& usb, QString defaultDestPath, Mode defaultMode);
+
+    private:
+        void onDeviceListed(UsbDevice* dev);
+        void onDeviceAboutToBeRemoved(UsbDevice* dev);
+        // The camera's own setting, or the default
+        [[nodiscard]] Mode mode(const UsbDevice& dev) const;
+
+        UsbManager& mUsb;
+        const QString mDefaultDestPath;
+        const Mode mDefaultMode;
+        // Imported since they were plugged in
+        QSet<UsbDevice*> mStarted;
+    };
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace CamWatcher {
+
+    /**
+     * Blocking FIFO with a fixed capacity, used to hand work between pipeline stages.
+     * Producers block while it is full, consumers block while it is empty.
+     */
+    template<typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t capacity) : mCapacity(capacity) {}
+
+        // Blocks while full, returns false if the queue was closed
+        bool push(T value) {
+            std::unique_lock lock(mMutex);
+            mNotFull.wait(lock, [this] { return mClosed || mItems.size() < mCapacity; });
+            if (mClosed)
+                return false;
+            mItems.push_back(std::move(value));
+            mNotEmpty.notify_one();
+            return true;
+        }
+
+        // Never blocks, returns false if the queue is full or closed
+        bool tryPush(T value) {
+            std::lock_guard lock(mMutex);
+            if (mClosed || mItems.size() >= mCapacity)
+                return false;
+            mItems.push_back(std::move(value));
+            mNotEmpty.notify_one();
+            return true;
+        }
+
+        // Blocks while empty, returns nothing once the queue is closed and drained
+        std::optional<T> pop() {
+            std::unique_lock lock(mMutex);
+            mNotEmpty.wait(lock, [this] { return mClosed || !mItems.empty(); });
+            if (mItems.empty())
+                return std::nullopt;
+            T value = std::move(mItems.front());
+            mItems.pop_front();
+            mNotFull.notify_one();
+            return value;
+        }
+
+        // No more items will be pushed, consumers drain what is left
+        void close() {
+            std::lock_guard lock(mMutex);
+            mClosed = true;
+            mNotEmpty.notify_all();
+            mNotFull.notify_all();
+        }
+
+        // Drop everything and wake up all waiters
+        void abort() {
+            std::lock_guard lock(mMutex);
+            mClosed = true;
+            mItems.clear();
+            mNotEmpty.notify_all();
+            mNotFull.notify_all();
+        }
+
+    private:
+        const size_t mCapacity;
+        std::deque<T> mItems;
+        bool mClosed = false;
+        std::mutex mMutex;
+        std::condition_variable mNotEmpty;
+        std::condition_variable mNotFull;
+    };
+
+}
@@ -0,0 +1,44 @@
+#include "camerabackend.h"
+
+#include "gphotoclibackend.h"
+#include "libgphotobackend.h"
+#include "mockbackend.h"
+
+#include <QtDebug>
+
+using namespace CamWatcher;
+
+QString CameraBackend::detectCamera(const int bus, const int port, std::optional<DetectedCamera>& camera) {
+    QVector<DetectedCamera> cameras;
+    if (const auto err = detectCameras(cameras); !err.isEmpty())
+        return err;
+
+    camera.reset();
+    for (const auto& cam: cameras) {
+        if (cam.bus == bus && cam.port == port)
+            camera = cam;
+    }
+    return {};
+}
+
+std::unique_ptr<CameraBackend> CameraBackend::create() {
+    const auto requested = qEnvironmentVariable("CAMWATCHER_BACKEND").toLower();
+
+    std::unique_ptr<CameraBackend> backend;
+    if (requested == "mock") {
+        backend = std::make_unique<MockBackend>();
+    } else if (requested == "cli") {
+        backend = std::make_unique<GPhotoCliBackend>();
+    } else {
+#ifdef CAMWATCHER_WITH_LIBGPHOTO2
+        backend = std::make_unique<LibGPhotoBackend>();
+#else
+        if (requested == "libgphoto2")
+            qWarning() << "Built without libgphoto2, falling back to the gphoto2 command line";
+        backend = std::make_unique<GPhotoCliBackend>();
+#endif
+    }
+
+    qInfo() << "Camera backend:" << backend->name();
+    return backend;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "canceltoken.h"
+#include "udevmonitor.h"
+#include "usbdevice.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include <optional>
+
+namespace CamWatcher {
+
+    struct DetectedCamera {
+        QString name;
+        int bus;
+        int port;
+    };
+
+    // Receives file contents in chunks, return false to abort the transfer
+    using DataSink = std::function<bool(const char* data, qint64 size)>;
+    // Receives listing results a batch at a time while the listing is still running
+    using FileBatchSink = std::function<void(const QVector<UsbFile>& files)>;
+    // Receives cameras coming and going, from any thread
+    using UsbEventSink = std::function<void(const QVector<UsbEvent>& events)>;
+
+    /**
+     * An open connection to a single camera.
+     * Calls may come from any thread, implementations serialize access to the device themselves.
+     * All functions return an error message, or an empty string on success.
+     */
+    class CameraSession {
+    public:
+        virtual ~CameraSession() = default;
+
+        virtual QString listFiles(const FileBatchSink& sink) = 0;
+        // Stream the file from offset onwards, used to resume interrupted transfers. Once cancelled the transfer
+        // is abandoned as soon as the backend can, also while waiting on the camera.
+        virtual QString readFile(const QString& cameraPath, qint64 offset, const DataSink& sink,
+                                 const CancelToken& cancel) = 0;
+        virtual QString deleteFile(const QString& cameraPath) = 0;
+        // Several files in one folder (with a trailing slash) in one go. Deleted is how many of them, from the front,
+        // are known to be gone, also when an error is returned.
+        virtual QString deleteFiles(const QString& folder, const QStringList& fileNames, int& deleted) {
+            deleted = 0;
+            for (const auto& fileName: fileNames) {
+                if (auto err = deleteFile(folder + fileName); !err.isEmpty())
+                    return err;
+                deleted++;
+            }
+            return {};
+        }
+
+        // Exact size and partial reads, for backends that can do them without fetching the whole file
+        [[nodiscard]] virtual bool supportsRangeReads() const {
+            return false;
+        }
+        virtual QString fileSize(const QString& cameraPath, qint64& bytes) {
+            Q_UNUSED(cameraPath)
+            Q_UNUSED(bytes)
+            return "Not supported";
+        }
+        virtual QString readRange(const QString& cameraPath, qint64 offset, qint64 length, QByteArray& data) {
+            Q_UNUSED(cameraPath)
+            Q_UNUSED(offset)
+            Q_UNUSED(length)
+            Q_UNUSED(data)
+            return "Not supported";
+        }
+        // The small preview the camera embeds in the file (usually a JPEG), without reading the file itself. Gives up
+        // once cancelled, also while waiting for the session.
+        virtual QString readThumbnail(const QString& cameraPath, QByteArray& data, const CancelToken& cancel) {
+            Q_UNUSED(cameraPath)
+            Q_UNUSED(data)
+            Q_UNUSED(cancel)
+            return "Not supported";
+        }
+    };
+
+    class CameraBackend {
+    public:
+        virtual ~CameraBackend() = default;
+
+        [[nodiscard]] virtual QString name() const = 0;
+        virtual QString detectCameras(QVector<DetectedCamera>& cameras) = 0;
+        // Probe a single port, camera is left empty if there is none. Defaults to filtering detectCameras().
+        virtual QString detectCamera(int bus, int port, std::optional<DetectedCamera>& camera);
+        virtual std::shared_ptr<CameraSession> openSession(const QString& name, int bus, int port) = 0;
+        // For cameras that udev doesn't know about, report them coming and going to sink
+        virtual void watchEvents(UsbEventSink sink) {
+            Q_UNUSED(sink)
+        }
+
+        /**
+         * Create the backend selected by the CAMWATCHER_BACKEND environment variable:
+         * "libgphoto2", "cli" or "mock". Defaults to libgphoto2 when available, the gphoto2 command line otherwise.
+         */
+        static std::unique_ptr<CameraBackend> create();
+    };
+
+}
@@ -25,5 +25,9 @@ void CameraListWidget::onDeviceAdded(UsbDevice* dev) {
 }
 
 void CameraListWidget::onDeviceAboutToBeRemoved(UsbDevice* dev) {
-    mWidgets.take(dev)->deleteLater();
+    // The device goes right after this. Thumbnail reads still running are cancelled, not waited for.
+    const auto w = mWidgets.take(dev);
+    w->releaseDevice();
+    w->hide();
+    w->deleteLater();
 }
\ No newline at end of file
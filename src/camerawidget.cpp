@@ -9,7 +9,7 @@
 
 using namespace CamWatcher;
 
-CameraWidget::CameraWidget(UsbDevice& device) : mDevice(device) {
+CameraWidget::CameraWidget(UsbDevice& device) : mDevice(device), mThumbnailStrip(device) {
     setObjectName("cameraWidget");
     setLayout(&mVBoxLayout);
     {
@@ -19,6 +19,7 @@ CameraWidget::CameraWidget(UsbDevice& device) : mDevice(device) {
         mDescLabel.setText("Description Here");
         mDescLabel.setObjectName("descLabel");
         mVBoxLayout.addWidget(&mDescLabel);
+        mVBoxLayout.addWidget(&mThumbnailStrip);
         mProgressBar.setTextVisible(false);
 
         mVBoxLayout.addLayout(&mHBoxLayout);
@@ -41,6 +42,19 @@ CameraWidget::CameraWidget(UsbDevice& device) : mDevice(device) {
             {UsbDevice::State::Cancel, std::bind(&CameraWidget::state_Cancel, this, std::placeholders::_1)},
     };
 
+    // Backup destinations, every import also goes there
+    mAddMirrorAction.setText("Add backup destination...");
+    connect(&mAddMirrorAction, &QAction::triggered, this, &CameraWidget::addMirrorPath);
+    mClearMirrorsAction.setText("Remove backup destinations");
+    connect(&mClearMirrorsAction, &QAction::triggered, [this] {
+        mDevice.setMirrorPaths({});
+        if (mDevice.state() == UsbDevice::VerifyCopy)
+            resetState();
+    });
+    addAction(&mAddMirrorAction);
+    addAction(&mClearMirrorsAction);
+    setContextMenuPolicy(Qt::ActionsContextMenu);
+
     connect(&mDevice, &UsbDevice::stateChanged, this, &CameraWidget::onDeviceStateChanged);
     onDeviceStateChanged(UsbDevice::State::Init);
 }
@@ -49,11 +63,17 @@ UsbDevice& CameraWidget::device() const {
     return mDevice;
 }
 
+void CameraWidget::releaseDevice() {
+    disconnect(&mDevice, nullptr, this, nullptr);
+    mThumbnailStrip.releaseDevice();
+}
+
 void CameraWidget::onDeviceStateChanged(const UsbDevice::State& state, const StateParm& parm) {
     mLeftButton.setVisible(false);
     mMiddleButton.setVisible(false);
     mRightButton.setVisible(false);
     mProgressBar.setVisible(false);
+    mThumbnailStrip.setVisible(false);
 
     mLeftButton.disconnect();
     mMiddleButton.disconnect();
@@ -90,7 +110,18 @@ QString CameraWidget::ensureDestinationPath(bool forcePrompt) {
     return filePath;
 }
 
+void CameraWidget::addMirrorPath() {
+    const auto path = QFileDialog::getExistingDirectory(this, "Select Backup Directory", QDir::homePath());
+    if (path.isEmpty())
+        return;
 
+    auto paths = mDevice.mirrorPaths();
+    if (!paths.contains(path) && path != mDevice.destFilePath())
+        paths << path;
+    mDevice.setMirrorPaths(paths);
+    if (mDevice.state() == UsbDevice::VerifyCopy)
+        resetState();
+}
 
 void CameraWidget::state_Init(const StateParm& parm) {
     mDescLabel.setText(parm.toString());
@@ -98,23 +129,37 @@ void CameraWidget::state_Init(const StateParm& parm) {
 
 void CameraWidget::state_Idle(const StateParm& parm) {
 
-    mDescLabel.setText(QString("File count: %1").arg(mDevice.fileCount()));
+    const int newFiles = mDevice.newFileCount();
+    if (newFiles == 0)
+        mDescLabel.setText(QString("File count: %1 (nothing new)").arg(mDevice.fileCount()));
+    else
+        mDescLabel.setText(QString("File count: %1 (%2 new)").arg(mDevice.fileCount()).arg(newFiles));
 
     if (mDevice.fileCount() == 0) {
         return;
     }
 
+    // Only new files are transferred, everything again only when asked for explicitly
+    const bool reimport = newFiles == 0;
+    const auto all = reimport ? " all again" : "";
+
+    // A look at what's about to be transferred
+    mThumbnailStrip.setFiles(reimport ? mDevice.files() : mDevice.copyableUsbFiles());
+    mThumbnailStrip.setVisible(true);
+
     mLeftButton.setVisible(true);
-    mLeftButton.setText("Copy");
-    connect(&mLeftButton, &QPushButton::clicked, [this] {
+    mLeftButton.setText(QString("Copy%1").arg(all));
+    connect(&mLeftButton, &QPushButton::clicked, [this, reimport] {
         bool removeOriginals = false;
+        mReimport = reimport;
         setState(UsbDevice::State::VerifyCopy, removeOriginals);
     });
 
     mRightButton.setVisible(true);
-    mRightButton.setText("Move");
-    connect(&mRightButton, &QPushButton::clicked, [this] {
+    mRightButton.setText(QString("Move%1").arg(all));
+    connect(&mRightButton, &QPushButton::clicked, [this, reimport] {
         bool removeOriginals = true;
+        mReimport = reimport;
         setState(UsbDevice::State::VerifyCopy, removeOriginals);
     });
 }
@@ -128,12 +173,14 @@ void CameraWidget::state_VerifyCopy(const StateParm& parm) {
 
     const auto path = ensureDestinationPath();
 
-    mDescLabel.setText(QString("%1 here?\n%2").arg(copyOrMoveC).arg(path));
+    auto msg = QString("%1 here?\n%2").arg(copyOrMoveC).arg(path);
+    for (const auto& mirrorPath: mDevice.mirrorPaths()) msg += QString("\nBackup to %1").arg(mirrorPath);
+    mDescLabel.setText(msg);
 
     mLeftButton.setVisible(true);
     mLeftButton.setText("Yes");
     connect(&mLeftButton, &QPushButton::clicked, [this, removeOriginals] {
-        mDevice.usbManager().downloadFiles(mDevice, removeOriginals);
+        mDevice.usbManager().downloadFiles(mDevice, removeOriginals, mReimport);
     });
 
     mMiddleButton.setVisible(true);
@@ -154,11 +201,11 @@ void CameraWidget::state_Copy(const StateParm& parm) {
 
     auto msg = QString("%1 file %2/%3").arg(copyingOrMoving).arg(stats.copiedFiles + 1).arg(stats.totalFiles);
     if (stats.copiedKbs > 0) {
-        const auto kbsLeft = stats.totalKbs - stats.copiedKbs;
-        const auto secondsRemaining = kbsLeft / stats.kbps;
-        auto fmtTime = QDateTime::fromTime_t(secondsRemaining).toUTC().toString("hh:mm:ss");
-        auto eta = QString(" (ETA %1)").arg(fmtTime);
-        msg += eta;
+        if (stats.secondsRemaining >= 0) {
+            auto fmtTime = QDateTime::fromTime_t(stats.secondsRemaining).toUTC().toString("hh:mm:ss");
+            auto eta = QString(" (ETA %1, %2 MB/s)").arg(fmtTime).arg(stats.kbps / 1024.0, 0, 'f', 1);
+            msg += eta;
+        }
 
         mProgressBar.setRange(0, stats.totalKbs);
         mProgressBar.setValue(stats.copiedKbs);
@@ -182,9 +229,9 @@ void CameraWidget::state_Done(const StateParm& parm) {
     mDescLabel.setText(parm.toString());
     mLeftButton.setVisible(true);
     mLeftButton.setText("Okay");
+    // The catalog already knows what was imported or removed, no need to list the card again
     connect(&mLeftButton, &QPushButton::clicked, [this] {
-        device().usbManager().listFiles(device());
-        setState(UsbDevice::Init);
+        setState(UsbDevice::Idle);
     });
 }
 
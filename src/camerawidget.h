@@ -1,11 +1,13 @@
 #pragma once
 
+#include <QAction>
 #include <QFileDialog>
 #include <QLabel>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QProgressBar>
 
+#include "thumbnailstrip.h"
 #include "usbdevice.h"
 #include "usbmanager.h"
 
@@ -16,12 +18,15 @@ namespace CamWatcher {
     public:
         explicit CameraWidget(UsbDevice& device);
         UsbDevice& device() const;
+        // The device is about to go, let go of it without waiting on the camera
+        void releaseDevice();
 
     private:
         void onDeviceStateChanged(const UsbDevice::State& state, const StateParm& parm = {});
         void setState(const UsbDevice::State& state, const StateParm& parm = {}) const;
         void resetState();
         QString ensureDestinationPath(bool forcePrompt = false);
+        void addMirrorPath();
 
         void state_Init(const StateParm& parm);
         void state_Idle(const StateParm& parm);
@@ -41,6 +46,11 @@ namespace CamWatcher {
         QPushButton mMiddleButton;
         QPushButton mRightButton;
         QProgressBar mProgressBar;
+        ThumbnailStrip mThumbnailStrip;
+        QAction mAddMirrorAction;
+        QAction mClearMirrorsAction;
+        // Everything was imported before, the user asked for all of it again
+        bool mReimport = false;
 
         QMap<UsbDevice::State, std::function<void(const StateParm&)>> mStateHandlers;
     };
@@ -1,4 +1,6 @@
 #include "camerawindow.h"
+#include "metrics.h"
+#include "procstats.h"
 
 #include <QApplication>
 #include <QMouseEvent>
@@ -86,3 +88,17 @@ void CameraWindow::mouseReleaseEvent(QMouseEvent* event) {
     s.setValue("winGeo", saveGeometry());
     s.sync();
 }
+
+void CameraWindow::paintEvent(QPaintEvent* event) {
+    QMainWindow::paintEvent(event);
+    if (mPainted)
+        return;
+    mPainted = true;
+
+    // How long it took from launching to showing something, the devices may still be probing
+    const auto stats = logProcStats("First paint");
+    if (Metrics::enabled() && stats.msSinceStart >= 0) {
+        const auto now = Metrics::Clock::now();
+        Metrics::instance().record("first paint", {}, now - std::chrono::milliseconds(stats.msSinceStart), now);
+    }
+}
@@ -37,9 +37,11 @@ namespace CamWatcher {
         void mousePressEvent(QMouseEvent* event) override;
         void mouseMoveEvent(QMouseEvent* event) override;
         void mouseReleaseEvent(QMouseEvent* event) override;
+        void paintEvent(QPaintEvent* event) override;
 
     private:
         bool mDragging = false;
+        bool mPainted = false;
         UsbManager& mUsbMan;
         QPoint mCursorOffset;
         MainLayoutWidget mMainWidget;
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace CamWatcher {
+
+    /**
+     * Asks a running job to stop. Copies share the flag, so the side that cancels keeps one and hands the job
+     * another. cancel() may be called from any thread, the job checks isCancelled() wherever it can stop cleanly.
+     */
+    class CancelToken {
+    public:
+        CancelToken() : mCancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+        void cancel() const {
+            mCancelled->store(true, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] bool isCancelled() const {
+            return mCancelled->load(std::memory_order_relaxed);
+        }
+
+        // Copies of the same token
+        bool operator==(const CancelToken& other) const {
+            return mCancelled == other.mCancelled;
+        }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> mCancelled;
+    };
+
+}
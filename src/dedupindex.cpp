@@ -0,0 +1,139 @@
+#include "dedupindex.h"
+
+#include "hash64.h"
+#include "metrics.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QtDebug>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace CamWatcher;
+
+DedupIndex::DedupIndex(QString rootPath) : mRootPath(std::move(rootPath)) {}
+
+void DedupIndex::build() {
+    std::call_once(mBuilt, [this] {
+        StageTimer timer("index");
+        const QDir root(mRootPath);
+
+        // Files right under the root, then one work item per subdirectory
+        QStringList dirs;
+        for (const auto& info: root.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
+            if (info.isDir())
+                dirs << info.filePath();
+            else
+                add(info.filePath(), info.size());
+        }
+
+        std::atomic<int> nextDir = 0;
+        const auto scan = [this, &dirs, &nextDir] {
+            QVector<QPair<QString, qint64>> found;
+            for (int i = nextDir++; i < dirs.size(); i = nextDir++) {
+                QDirIterator it(dirs[i], QDir::Files, QDirIterator::Subdirectories);
+                while (it.hasNext()) {
+                    it.next();
+                    found.append({it.filePath(), it.fileInfo().size()});
+                }
+            }
+            for (const auto& [path, size]: found) add(path, size);
+        };
+
+        const int threadCount = qBound(1, QThread::idealThreadCount(), dirs.size());
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadCount; i++) threads.emplace_back(scan);
+        scan();
+        for (auto& t: threads) t.join();
+
+        std::lock_guard lock(mMutex);
+        qInfo() << "Indexed" << mEntries.size() << "files in" << mRootPath;
+    });
+}
+
+DedupIndex::Match DedupIndex::find(const QString& fileName, const int kbSize,
+                                   const CameraFingerprint& cameraFingerprint, QString* existingPath) {
+    // Without a size there is nothing to go on
+    if (kbSize <= 0)
+        return Match::None;
+
+    // Camera sizes are rounded to KB, allow for either rounding direction
+    QVector<Entry> candidates;
+    {
+        std::lock_guard lock(mMutex);
+        for (auto it = mEntries.constFind(fileName); it != mEntries.constEnd() && it.key() == fileName; ++it) {
+            if (qAbs(it->size / 1024 - kbSize) <= 1)
+                candidates.append(*it);
+        }
+    }
+    if (candidates.isEmpty())
+        return Match::None;
+
+    std::optional<QPair<qint64, quint64>> camera;
+    if (cameraFingerprint)
+        camera = cameraFingerprint();
+    if (!camera) {
+        if (existingPath)
+            *existingPath = candidates.first().path;
+        return Match::Weak;
+    }
+
+    const auto [cameraSize, cameraHash] = *camera;
+    for (const auto& candidate: candidates) {
+        if (candidate.size != cameraSize)
+            continue;
+
+        auto hash = candidate.fingerprint;
+        if (!hash) {
+            hash = fileFingerprint(candidate.path, candidate.size);
+            std::lock_guard lock(mMutex);
+            for (auto it = mEntries.find(fileName); it != mEntries.end() && it.key() == fileName; ++it) {
+                if (it->path == candidate.path)
+                    it->fingerprint = hash;
+            }
+        }
+
+        if (hash && *hash == cameraHash) {
+            if (existingPath)
+                *existingPath = candidate.path;
+            return Match::Strong;
+        }
+    }
+    return Match::None;
+}
+
+void DedupIndex::add(const QString& filePath, const qint64 size) {
+    const auto fileName = QFileInfo(filePath).fileName();
+
+    std::lock_guard lock(mMutex);
+    for (auto it = mEntries.find(fileName); it != mEntries.end() && it.key() == fileName; ++it) {
+        if (it->path == filePath) {
+            *it = {filePath, size, std::nullopt};
+            return;
+        }
+    }
+    mEntries.insert(fileName, {filePath, size, std::nullopt});
+}
+
+quint64 DedupIndex::fingerprint(const QByteArray& head, const QByteArray& tail, const qint64 size) {
+    Hash64 hasher(static_cast<uint64_t>(size));
+    hasher.update(head.constData(), head.size());
+    hasher.update(tail.constData(), tail.size());
+    return hasher.digest();
+}
+
+std::optional<quint64> DedupIndex::fileFingerprint(const QString& filePath, const qint64 size) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return std::nullopt;
+
+    const auto head = file.read(qMin(size, fingerprintBytes));
+    if (!file.seek(qMax<qint64>(0, size - fingerprintBytes)))
+        return std::nullopt;
+    const auto tail = file.read(qMin(size, fingerprintBytes));
+    return fingerprint(head, tail, size);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QMultiHash>
+#include <QPair>
+#include <QString>
+#include <functional>
+#include <mutex>
+#include <optional>
+
+namespace CamWatcher {
+
+    /**
+     * Files already present under a destination directory, looked up by name and size,
+     * confirmed with a hash over the first and last fingerprintBytes of the file.
+     * Lets us skip files before any of their bytes cross USB. Thread safe.
+     */
+    class DedupIndex {
+    public:
+        enum class Match {
+            None,
+            // Same name and size, the camera can't tell us more. Not enough to skip a file on.
+            Weak,
+            // Same name, exact size and fingerprint
+            Strong,
+        };
+
+        // Exact size in bytes of the camera file and its fingerprint, nothing if the camera can't read ranges
+        using CameraFingerprint = std::function<std::optional<QPair<qint64, quint64>>()>;
+
+        static constexpr qint64 fingerprintBytes = 64 * 1024;
+
+        explicit DedupIndex(QString rootPath);
+
+        // Scan the destination on a few threads, only the first call does any work
+        void build();
+        Match find(const QString& fileName, int kbSize, const CameraFingerprint& cameraFingerprint,
+                   QString* existingPath = nullptr);
+        // Register a file that just landed
+        void add(const QString& filePath, qint64 size);
+
+        static quint64 fingerprint(const QByteArray& head, const QByteArray& tail, qint64 size);
+        static std::optional<quint64> fileFingerprint(const QString& filePath, qint64 size);
+
+    private:
+        struct Entry {
+            QString path;
+            qint64 size;
+            std::optional<quint64> fingerprint;
+        };
+
+        const QString mRootPath;
+        QMultiHash<QString, Entry> mEntries;
+        std::once_flag mBuilt;
+        std::mutex mMutex;
+    };
+
+}
@@ -0,0 +1,353 @@
+#include "diskwriter.h"
+
+#include <QFile>
+#include <QtDebug>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#ifdef CAMWATCHER_WITH_IO_URING
+#include <liburing.h>
+#endif
+
+using namespace CamWatcher;
+
+namespace {
+    // Writes go out in blocks of this size, starting at multiples of it in the file
+    constexpr int blockSize = 4 << 20;
+    // Blocks handed to the kernel but not done yet, bounds memory use
+    constexpr int maxBlocksInFlight = 4;
+    constexpr int fallbackThreadCount = 2;
+
+    QString errnoString(const int err) {
+        return QString::fromLocal8Bit(std::strerror(err));
+    }
+
+    // Runs a single op to completion, returns 0 or an errno
+    int runOp(const DiskWriter::Op& op) {
+        if (op.kind == DiskWriter::Op::DataSync)
+            return ::fdatasync(op.fd) == 0 ? 0 : errno;
+
+        const char* data = op.data.constData();
+        qint64 remaining = op.data.size();
+        qint64 offset = op.offset;
+        while (remaining > 0) {
+            const auto written = ::pwrite(op.fd, data, static_cast<size_t>(remaining), offset);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return errno;
+            }
+            data += written;
+            offset += written;
+            remaining -= written;
+        }
+        return 0;
+    }
+
+    // Plain pwrite and fdatasync on a few threads
+    class ThreadEngine : public DiskWriter::Engine {
+    public:
+        ThreadEngine() {
+            for (int i = 0; i < fallbackThreadCount; i++) mThreads.emplace_back(&ThreadEngine::work, this);
+        }
+
+        ~ThreadEngine() override {
+            {
+                std::lock_guard lock(mMutex);
+                mStopping = true;
+            }
+            mWorkAvailable.notify_all();
+            for (auto& t: mThreads) t.join();
+        }
+
+        void submit(DiskWriter::Op op) override {
+            {
+                std::lock_guard lock(mMutex);
+                mQueue.push_back(std::move(op));
+                mOutstanding++;
+            }
+            mWorkAvailable.notify_one();
+        }
+
+        QString wait(const int maxInFlight) override {
+            std::unique_lock lock(mMutex);
+            mWorkDone.wait(lock, [this, maxInFlight] { return mOutstanding <= maxInFlight; });
+            return std::exchange(mError, {});
+        }
+
+        [[nodiscard]] const char* name() const override {
+            return "threads";
+        }
+
+    private:
+        void work() {
+            std::unique_lock lock(mMutex);
+            while (true) {
+                mWorkAvailable.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+                if (mQueue.empty())
+                    return;
+                auto op = std::move(mQueue.front());
+                mQueue.pop_front();
+
+                lock.unlock();
+                const int err = runOp(op);
+                op.data.clear();
+                lock.lock();
+
+                if (err && mError.isEmpty())
+                    mError = errnoString(err);
+                mOutstanding--;
+                mWorkDone.notify_all();
+            }
+        }
+
+        std::vector<std::thread> mThreads;
+        std::deque<DiskWriter::Op> mQueue;
+        int mOutstanding = 0;
+        QString mError;
+        bool mStopping = false;
+        std::mutex mMutex;
+        std::condition_variable mWorkAvailable;
+        std::condition_variable mWorkDone;
+    };
+
+#ifdef CAMWATCHER_WITH_IO_URING
+    constexpr unsigned ringEntries = 64;
+
+    class UringEngine : public DiskWriter::Engine {
+    public:
+        // Returns nothing when the kernel doesn't let us have a ring
+        static std::unique_ptr<UringEngine> create() {
+            std::unique_ptr<UringEngine> engine(new UringEngine());
+            if (const int ret = io_uring_queue_init(ringEntries, &engine->mRing, 0); ret < 0) {
+                qInfo() << "io_uring not available:" << errnoString(-ret);
+                return nullptr;
+            }
+            engine->mInitialized = true;
+            return engine;
+        }
+
+        ~UringEngine() override {
+            if (!mInitialized)
+                return;
+            wait(0);
+            io_uring_queue_exit(&mRing);
+        }
+
+        void submit(DiskWriter::Op op) override {
+            auto pending = new DiskWriter::Op(std::move(op));
+            io_uring_sqe* sqe;
+            while (!(sqe = io_uring_get_sqe(&mRing))) reap();
+
+            if (pending->kind == DiskWriter::Op::DataSync) {
+                io_uring_prep_fsync(sqe, pending->fd, IORING_FSYNC_DATASYNC);
+            } else {
+                io_uring_prep_write(sqe, pending->fd, pending->data.constData(),
+                                    static_cast<unsigned>(pending->data.size()),
+                                    static_cast<__u64>(pending->offset));
+            }
+            io_uring_sqe_set_data(sqe, pending);
+            mOutstanding++;
+            io_uring_submit(&mRing);
+        }
+
+        QString wait(const int maxInFlight) override {
+            while (mOutstanding > maxInFlight) reap();
+            return std::exchange(mError, {});
+        }
+
+        [[nodiscard]] const char* name() const override {
+            return "io_uring";
+        }
+
+    private:
+        UringEngine() = default;
+
+        // Wait for one op to complete
+        void reap() {
+            io_uring_cqe* cqe = nullptr;
+            if (io_uring_wait_cqe(&mRing, &cqe) < 0 || !cqe)
+                return;
+
+            auto op = static_cast<DiskWriter::Op*>(io_uring_cqe_get_data(cqe));
+            const int res = cqe->res;
+            io_uring_cqe_seen(&mRing, cqe);
+            mOutstanding--;
+
+            // Short writes are rare on regular files, finish them synchronously
+            if (res >= 0 && op->kind == DiskWriter::Op::Write && res < op->data.size()) {
+                op->data.remove(0, res);
+                op->offset += res;
+                if (const int err = runOp(*op); err && mError.isEmpty())
+                    mError = errnoString(err);
+            } else if (res < 0 && mError.isEmpty()) {
+                mError = errnoString(-res);
+            }
+            delete op;
+        }
+
+        io_uring mRing{};
+        bool mInitialized = false;
+        int mOutstanding = 0;
+        QString mError;
+    };
+#endif
+
+    std::unique_ptr<DiskWriter::Engine> createEngine() {
+#ifdef CAMWATCHER_WITH_IO_URING
+        if (auto engine = UringEngine::create())
+            return engine;
+#endif
+        return std::make_unique<ThreadEngine>();
+    }
+}
+
+DiskWriter::DiskWriter() : mEngine(createEngine()) {
+    qDebug() << "Writing files using" << mEngine->name();
+}
+
+DiskWriter::~DiskWriter() {
+    mEngine->wait(0);
+    if (mFd >= 0)
+        ::close(mFd);
+    for (const int fd: mClosedFds) ::close(fd);
+}
+
+QString DiskWriter::open(const QString& path, const qint64 offset, const qint64 expectedSize) {
+    mFileName = path;
+    mFd = ::open(QFile::encodeName(path).constData(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (mFd < 0)
+        return failed("open");
+    if (::ftruncate(mFd, offset) != 0)
+        return failed("truncate");
+
+    // Keep the size as it is, camera sizes are only known to the KB and a resume goes by the size on disk
+    if (expectedSize > offset && ::fallocate(mFd, FALLOC_FL_KEEP_SIZE, offset, expectedSize - offset) != 0 &&
+        errno != EOPNOTSUPP && errno != ENOSYS)
+        return failed("reserve space for");
+
+    mStagedOffset = offset;
+    mStagedCapacity = static_cast<int>(blockSize - offset % blockSize);
+    mStaged.clear();
+    return {};
+}
+
+QString DiskWriter::write(const QByteArray& data) {
+    const char* p = data.constData();
+    int remaining = data.size();
+    while (remaining > 0) {
+        if (mStaged.capacity() < mStagedCapacity)
+            mStaged.reserve(mStagedCapacity);
+        const int n = qMin(remaining, mStagedCapacity - mStaged.size());
+        mStaged.append(p, n);
+        p += n;
+        remaining -= n;
+        if (mStaged.size() == mStagedCapacity) {
+            if (auto err = flushStaged(); !err.isEmpty())
+                return err;
+        }
+    }
+    return {};
+}
+
+QString DiskWriter::seek(const qint64 offset) {
+    if (auto err = flushStaged(); !err.isEmpty())
+        return err;
+    if (auto err = mEngine->wait(0); !err.isEmpty())
+        return QString("Failed to write %1: %2").arg(mFileName, err);
+    if (::ftruncate(mFd, offset) != 0)
+        return failed("truncate");
+
+    mStagedOffset = offset;
+    mStagedCapacity = static_cast<int>(blockSize - offset % blockSize);
+    return {};
+}
+
+QString DiskWriter::sync() {
+    if (auto err = flushStaged(); !err.isEmpty())
+        return err;
+    // Writes in flight are not ordered against the sync, let them finish first
+    auto err = mEngine->wait(0);
+    if (err.isEmpty()) {
+        mEngine->submit({Op::DataSync, mFd, 0, {}});
+        err = mEngine->wait(0);
+    }
+    return err.isEmpty() ? QString() : QString("Failed to write %1: %2").arg(mFileName, err);
+}
+
+QString DiskWriter::close() {
+    if (auto err = flushStaged(); !err.isEmpty())
+        return err;
+    if (auto err = mEngine->wait(0); !err.isEmpty())
+        return QString("Failed to write %1: %2").arg(mFileName, err);
+
+    // Give back what was reserved past the end
+    if (::ftruncate(mFd, mStagedOffset) != 0)
+        return failed("truncate");
+
+    mClosedFds.append(mFd);
+    mFd = -1;
+    return {};
+}
+
+QString DiskWriter::discard() {
+    mStaged.clear();
+    // Writes already handed to the kernel still use the fd
+    mEngine->wait(0);
+    ::close(mFd);
+    mFd = -1;
+    if (::unlink(QFile::encodeName(mFileName).constData()) != 0 && errno != ENOENT)
+        return QString("Failed to remove %1: %2").arg(mFileName, errnoString(errno));
+    return {};
+}
+
+QString DiskWriter::syncClosed() {
+    for (const int fd: mClosedFds) mEngine->submit({Op::DataSync, fd, 0, {}});
+    const auto err = mEngine->wait(0);
+    for (const int fd: mClosedFds) ::close(fd);
+    mClosedFds.clear();
+    return err.isEmpty() ? QString() : QString("Failed to sync files: %1").arg(err);
+}
+
+bool DiskWriter::isOpen() const {
+    return mFd >= 0;
+}
+
+qint64 DiskWriter::pos() const {
+    return mStagedOffset + mStaged.size();
+}
+
+const QString& DiskWriter::fileName() const {
+    return mFileName;
+}
+
+QString DiskWriter::flushStaged() {
+    if (mStaged.isEmpty())
+        return {};
+
+    const auto size = mStaged.size();
+    mEngine->submit({Op::Write, mFd, mStagedOffset, std::exchange(mStaged, {})});
+    mStagedOffset += size;
+    mStagedCapacity = blockSize;
+
+    if (auto err = mEngine->wait(maxBlocksInFlight - 1); !err.isEmpty())
+        return QString("Failed to write %1: %2").arg(mFileName, err);
+    return {};
+}
+
+QString DiskWriter::failed(const QString& what) {
+    const auto err = QString("Failed to %1 %2: %3").arg(what, mFileName, errnoString(errno));
+    if (mFd >= 0) {
+        ::close(mFd);
+        mFd = -1;
+    }
+    return err;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+namespace CamWatcher {
+
+    /**
+     * Writes files to the destination disk in large, offset aligned blocks that are handed to the kernel
+     * asynchronously: through io_uring when built with it and the kernel allows, a couple of threads doing pwrite
+     * otherwise. Space for each file is reserved up front so it doesn't end up in fragments.
+     *
+     * One file is written at a time. Closed files are synced together in syncClosed(), so a batch of files costs
+     * one round of flushes instead of a synchronous flush after every file. Not thread safe, use from one thread.
+     */
+    class DiskWriter {
+    public:
+        // One request to the kernel
+        struct Op {
+            enum Kind { Write, DataSync };
+            Kind kind;
+            int fd;
+            qint64 offset;
+            // Kept alive until the write completes
+            QByteArray data;
+        };
+
+        // Runs ops asynchronously, errors come back from wait()
+        class Engine {
+        public:
+            virtual ~Engine() = default;
+            virtual void submit(Op op) = 0;
+            // Block until no more than maxInFlight ops are outstanding, returns the first error since the last call
+            virtual QString wait(int maxInFlight) = 0;
+            [[nodiscard]] virtual const char* name() const = 0;
+        };
+
+        DiskWriter();
+        ~DiskWriter();
+
+        // Start writing a file at offset, anything past it is dropped. Space for expectedSize bytes is reserved.
+        QString open(const QString& path, qint64 offset, qint64 expectedSize);
+        // Append to the open file
+        QString write(const QByteArray& data);
+        // Continue at offset instead, dropping anything past it
+        QString seek(qint64 offset);
+        // Everything written to the open file so far is on disk
+        QString sync();
+        // Done with the open file, its data goes to disk with the next syncClosed()
+        QString close();
+        // Give up on the open file and delete it, nothing of it is synced
+        QString discard();
+        // All files closed since the last call are on disk
+        QString syncClosed();
+
+        [[nodiscard]] bool isOpen() const;
+        [[nodiscard]] qint64 pos() const;
+        [[nodiscard]] const QString& fileName() const;
+
+    private:
+        // Hand the staged block to the engine
+        QString flushStaged();
+        QString failed(const QString& what);
+
+        std::unique_ptr<Engine> mEngine;
+        int mFd = -1;
+        QString mFileName;
+        // File offset of mStaged, and how much the block may hold so it ends on a block boundary
+        qint64 mStagedOffset = 0;
+        int mStagedCapacity = 0;
+        QByteArray mStaged;
+        QVector<int> mClosedFds;
+    };
+
+}
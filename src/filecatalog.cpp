@@ -0,0 +1,147 @@
+#include "filecatalog.h"
+
+#include "hash64.h"
+#include "usbdevice.h"
+
+#include <algorithm>
+
+using namespace CamWatcher;
+
+FileCatalog::Builder::Builder() : mCatalog(std::make_shared<FileCatalog>()) {}
+
+void FileCatalog::Builder::reserve(const int count) {
+    mCatalog->mNameOffsets.reserve(count + 1);
+    mCatalog->mFolderIds.reserve(count);
+    mCatalog->mKbSizes.reserve(count);
+    mCatalog->mTimestamps.reserve(count);
+}
+
+void FileCatalog::Builder::append(const UsbFile& file) {
+    append(file.filePath(), file.kbSize(), file.timestamp());
+}
+
+void FileCatalog::Builder::append(const QString& filePath, const int kbSize, const qint64 timestamp) {
+    const auto slash = filePath.lastIndexOf('/');
+    const auto folderId = internFolder(filePath.left(slash + 1));
+
+    auto& c = *mCatalog;
+    c.mNames += filePath.midRef(slash + 1).toUtf8();
+    c.mNameOffsets.push_back(c.mNames.size());
+    c.mFolderIds.push_back(folderId);
+    c.mKbSizes.push_back(kbSize);
+    c.mTimestamps.push_back(timestamp);
+}
+
+void FileCatalog::Builder::append(const FileCatalog& catalog, const int index) {
+    const auto folderId = internFolder(catalog.folder(index));
+
+    auto& c = *mCatalog;
+    const auto nameStart = catalog.mNameOffsets[index];
+    c.mNames.append(catalog.mNames.constData() + nameStart, catalog.mNameOffsets[index + 1] - nameStart);
+    c.mNameOffsets.push_back(c.mNames.size());
+    c.mFolderIds.push_back(folderId);
+    c.mKbSizes.push_back(catalog.mKbSizes[index]);
+    c.mTimestamps.push_back(catalog.mTimestamps[index]);
+}
+
+int FileCatalog::Builder::size() const {
+    return mCatalog->size();
+}
+
+FileSnapshot FileCatalog::Builder::build() {
+    auto& c = *mCatalog;
+    c.mPathIndex.reserve(c.mKbSizes.size());
+    for (quint32 i = 0; i < c.mKbSizes.size(); i++) {
+        const auto nameStart = c.mNameOffsets[i];
+        const auto hash = pathHash(c.mFoldersUtf8[c.mFolderIds[i]], c.mNames.constData() + nameStart,
+                                   c.mNameOffsets[i + 1] - nameStart);
+        c.mPathIndex.emplace_back(hash, i);
+    }
+    std::sort(c.mPathIndex.begin(), c.mPathIndex.end());
+
+    FileSnapshot snapshot = std::move(mCatalog);
+    mCatalog = std::make_shared<FileCatalog>();
+    mFolderIds.clear();
+    return snapshot;
+}
+
+quint32 FileCatalog::Builder::internFolder(const QString& folder) {
+    const auto it = mFolderIds.constFind(folder);
+    if (it != mFolderIds.constEnd())
+        return *it;
+
+    const auto id = static_cast<quint32>(mCatalog->mFolders.size());
+    mCatalog->mFolders.append(folder);
+    mCatalog->mFoldersUtf8.append(folder.toUtf8());
+    mFolderIds.insert(folder, id);
+    return id;
+}
+
+FileSnapshot FileCatalog::empty() {
+    static const FileSnapshot emptyCatalog = std::make_shared<FileCatalog>();
+    return emptyCatalog;
+}
+
+int FileCatalog::size() const {
+    return static_cast<int>(mKbSizes.size());
+}
+
+bool FileCatalog::isEmpty() const {
+    return mKbSizes.empty();
+}
+
+QString FileCatalog::filePath(const int index) const {
+    return folder(index) + fileName(index);
+}
+
+QString FileCatalog::fileName(const int index) const {
+    const auto nameStart = mNameOffsets[index];
+    return QString::fromUtf8(mNames.constData() + nameStart, static_cast<int>(mNameOffsets[index + 1] - nameStart));
+}
+
+const QString& FileCatalog::folder(const int index) const {
+    return mFolders[static_cast<int>(mFolderIds[index])];
+}
+
+int FileCatalog::kbSize(const int index) const {
+    return mKbSizes[index];
+}
+
+qint64 FileCatalog::timestamp(const int index) const {
+    return mTimestamps[index];
+}
+
+UsbFile FileCatalog::file(const int index) const {
+    return {filePath(index), kbSize(index), timestamp(index)};
+}
+
+int FileCatalog::indexOf(const QString& filePath) const {
+    const auto utf8 = filePath.toUtf8();
+    const auto hash = Hash64::hash(utf8.constData(), utf8.size());
+    auto it = std::lower_bound(mPathIndex.begin(), mPathIndex.end(), std::make_pair(hash, quint32(0)));
+    // Hashes can collide, confirm with the path
+    for (; it != mPathIndex.end() && it->first == hash; ++it) {
+        if (this->filePath(static_cast<int>(it->second)) == filePath)
+            return static_cast<int>(it->second);
+    }
+    return -1;
+}
+
+qint64 FileCatalog::memoryUsage() const {
+    qint64 bytes = mNames.capacity();
+    for (const auto& f: mFolders) bytes += f.capacity() * 2;
+    for (const auto& f: mFoldersUtf8) bytes += f.capacity();
+    bytes += mNameOffsets.capacity() * sizeof(quint32);
+    bytes += mFolderIds.capacity() * sizeof(quint32);
+    bytes += mKbSizes.capacity() * sizeof(qint32);
+    bytes += mTimestamps.capacity() * sizeof(qint64);
+    bytes += mPathIndex.capacity() * sizeof(mPathIndex[0]);
+    return bytes;
+}
+
+quint64 FileCatalog::pathHash(const QByteArray& folderUtf8, const char* name, const int nameSize) {
+    Hash64 hasher;
+    hasher.update(folderUtf8.constData(), folderUtf8.size());
+    hasher.update(name, nameSize);
+    return hasher.digest();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+namespace CamWatcher {
+
+    class UsbFile;
+    class FileCatalog;
+
+    // Immutable, so a snapshot is handed between threads and stages by copying a pointer
+    using FileSnapshot = std::shared_ptr<const FileCatalog>;
+
+    /**
+     * The files on a camera, stored by column: folders are interned, names live in one UTF-8 arena,
+     * sizes and timestamps in plain arrays. A 100k file card fits in a few MB.
+     * Rows are addressed by index, UsbFile values are only made for the few rows that need one.
+     */
+    class FileCatalog {
+    public:
+        class Builder {
+        public:
+            Builder();
+
+            void reserve(int count);
+            void append(const UsbFile& file);
+            void append(const QString& filePath, int kbSize, qint64 timestamp);
+            // Copy a row from another catalog
+            void append(const FileCatalog& catalog, int index);
+            [[nodiscard]] int size() const;
+            // The builder starts over afterwards
+            FileSnapshot build();
+
+        private:
+            quint32 internFolder(const QString& folder);
+
+            std::shared_ptr<FileCatalog> mCatalog;
+            QHash<QString, quint32> mFolderIds;
+        };
+
+        static FileSnapshot empty();
+
+        [[nodiscard]] int size() const;
+        [[nodiscard]] bool isEmpty() const;
+        [[nodiscard]] QString filePath(int index) const;
+        [[nodiscard]] QString fileName(int index) const;
+        // Including the trailing slash
+        [[nodiscard]] const QString& folder(int index) const;
+        [[nodiscard]] int kbSize(int index) const;
+        [[nodiscard]] qint64 timestamp(int index) const;
+        [[nodiscard]] UsbFile file(int index) const;
+        // Row of a path, -1 if it isn't there
+        [[nodiscard]] int indexOf(const QString& filePath) const;
+        // Bytes held by the columns, for logging
+        [[nodiscard]] qint64 memoryUsage() const;
+
+    private:
+        static quint64 pathHash(const QByteArray& folderUtf8, const char* name, int nameSize);
+
+        QStringList mFolders;
+        QVector<QByteArray> mFoldersUtf8;
+        QByteArray mNames;
+        // Name of row i spans mNameOffsets[i] up to mNameOffsets[i + 1]
+        std::vector<quint32> mNameOffsets{0};
+        std::vector<quint32> mFolderIds;
+        std::vector<qint32> mKbSizes;
+        std::vector<qint64> mTimestamps;
+        // Path hash and row, sorted by hash, for indexOf()
+        std::vector<std::pair<quint64, quint32>> mPathIndex;
+    };
+
+}
@@ -0,0 +1,165 @@
+#include "gphotoclibackend.h"
+
+#include "gphotoparser.h"
+#include "utils.h"
+
+#include <mutex>
+
+using namespace CamWatcher;
+
+namespace {
+
+    // Listed files are handed out in batches of this size
+    constexpr int listBatchSize = 256;
+    // Commands that should be over quickly
+    constexpr int shortCmdTimeoutMs = 30 * 1000;
+    // Deleting a batch gets this long per file on top
+    constexpr int deleteTimeoutMs = 5 * 1000;
+    // Listing a big card or reading a long clip can take any amount of time, as long as data keeps coming
+    constexpr int stallTimeoutMs = 60 * 1000;
+
+    CmdOptions cmdOptions(const int timeoutMs, const int stallMs, CancelToken cancel = {}) {
+        CmdOptions options;
+        options.timeoutMs = timeoutMs;
+        options.stallTimeoutMs = stallMs;
+        options.cancel = std::move(cancel);
+        return options;
+    }
+
+    class GPhotoCliSession final : public CameraSession {
+    public:
+        explicit GPhotoCliSession(QString portPath) : mPortPath(std::move(portPath)) {}
+
+        QString listFiles(const FileBatchSink& sink) override {
+            std::lock_guard lock(mMutex);
+
+            // Folder with a trailing slash, in UTF-8 like the lines
+            QByteArray currentFolder;
+            QVector<UsbFile> batch;
+            QByteArray pending;
+
+            const auto parseLine = [&](const std::string_view line) {
+                if (const auto folder = parseFolderLine(line)) {
+                    currentFolder = QByteArray(folder->data(), static_cast<int>(folder->size()));
+                    if (!currentFolder.endsWith('/'))
+                        currentFolder += '/';
+                    return;
+                }
+                if (const auto file = parseFileLine(line)) {
+                    auto filePath = QString::fromUtf8(currentFolder);
+                    filePath += QString::fromUtf8(file->name.data(), static_cast<int>(file->name.size()));
+                    batch.append({filePath, file->kbSize, file->timestamp});
+                }
+            };
+
+            // Parse complete lines as they come in, keep the unterminated tail for the next chunk
+            const auto onOutput = [&](const QByteArray& chunk) {
+                pending += chunk;
+                const auto used = forEachLine({pending.constData(), static_cast<size_t>(pending.size())}, parseLine);
+                pending.remove(0, static_cast<int>(used));
+
+                if (batch.size() >= listBatchSize) {
+                    sink(batch);
+                    batch.clear();
+                }
+                return true;
+            };
+
+            const auto output = streamCmd({"gphoto2", "--list-files", "--port=" + mPortPath}, onOutput,
+                                          cmdOptions(0, stallTimeoutMs));
+            if (output.hasError())
+                return output.err;
+
+            if (!pending.isEmpty())
+                parseLine({pending.constData(), static_cast<size_t>(pending.size())});
+            if (!batch.isEmpty())
+                sink(batch);
+            return {};
+        }
+
+        QString readFile(const QString& cameraPath, const qint64 offset, const DataSink& sink,
+                         const CancelToken& cancel) override {
+            std::lock_guard lock(mMutex);
+            // gphoto2 can't start halfway, so throw away what we already have
+            qint64 toSkip = offset;
+            const auto onOutput = [&sink, &toSkip](const QByteArray& chunk) {
+                const auto skip = qMin<qint64>(toSkip, chunk.size());
+                toSkip -= skip;
+                return skip == chunk.size() || sink(chunk.constData() + skip, chunk.size() - skip);
+            };
+            return streamCmd({"gphoto2", "--get-file", cameraPath, "--stdout", "--port", mPortPath}, onOutput,
+                             cmdOptions(0, stallTimeoutMs, cancel))
+                    .err;
+        }
+
+        QString readThumbnail(const QString& cameraPath, QByteArray& data, const CancelToken& cancel) override {
+            std::lock_guard lock(mMutex);
+            if (cancel.isCancelled())
+                return "Cancelled";
+            data.clear();
+            const auto onOutput = [&data](const QByteArray& chunk) {
+                data.append(chunk);
+                return true;
+            };
+            return streamCmd({"gphoto2", "--get-thumbnail", cameraPath, "--stdout", "--port", mPortPath}, onOutput,
+                             cmdOptions(shortCmdTimeoutMs, 0, cancel))
+                    .err;
+        }
+
+        QString deleteFile(const QString& cameraPath) override {
+            std::lock_guard lock(mMutex);
+            return runCmd({"gphoto2", "--delete-file", cameraPath, "--port", mPortPath},
+                          cmdOptions(shortCmdTimeoutMs, 0))
+                    .err;
+        }
+
+        // gphoto2 runs its actions in order, so one process deletes the lot
+        QString deleteFiles(const QString& folder, const QStringList& fileNames, int& deleted) override {
+            std::lock_guard lock(mMutex);
+            QStringList cmd{"gphoto2", "--port", mPortPath};
+            for (const auto& fileName: fileNames) cmd << "--delete-file" << folder + fileName;
+            const auto timeoutMs = shortCmdTimeoutMs + deleteTimeoutMs * static_cast<int>(fileNames.size());
+            const auto err = runCmd(cmd, cmdOptions(timeoutMs, 0)).err;
+            // No telling how far it got when it fails, the next listing sorts that out
+            deleted = err.isEmpty() ? static_cast<int>(fileNames.size()) : 0;
+            return err;
+        }
+
+    private:
+        const QString mPortPath;
+        // gphoto2 processes fight over the device, run one at a time
+        std::mutex mMutex;
+    };
+
+}
+
+QString GPhotoCliBackend::name() const {
+    return "gphoto2 (command line)";
+}
+
+QString GPhotoCliBackend::detectCameras(QVector<DetectedCamera>& cameras) {
+    // The raw bytes, only the model names are ever made into strings
+    QByteArray out;
+    const auto collect = [&out](const QByteArray& chunk) {
+        out += chunk;
+        return true;
+    };
+    if (const auto err = streamCmd({"gphoto2", "--auto-detect"}, collect, cmdOptions(shortCmdTimeoutMs, 0)).err;
+        !err.isEmpty())
+        return err;
+
+    const auto parseLine = [&cameras](const std::string_view line) {
+        if (const auto camera = parseAutoDetectLine(line))
+            cameras.append({QString::fromUtf8(camera->name.data(), static_cast<int>(camera->name.size())),
+                            camera->bus, camera->port});
+    };
+    const auto used = forEachLine({out.constData(), static_cast<size_t>(out.size())}, parseLine);
+    if (used < static_cast<size_t>(out.size()))
+        parseLine({out.constData() + used, out.size() - used});
+    return {};
+}
+
+std::shared_ptr<CameraSession> GPhotoCliBackend::openSession(const QString& name, int bus, int port) {
+    Q_UNUSED(name)
+    return std::make_shared<GPhotoCliSession>(createPortPath(bus, port));
+}
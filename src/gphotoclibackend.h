@@ -0,0 +1,18 @@
+#pragma once
+
+#include "camerabackend.h"
+
+namespace CamWatcher {
+
+    /**
+     * Drives the camera by spawning a gphoto2 process for every operation.
+     * Slow, but works with any gphoto2 install, no development headers needed.
+     */
+    class GPhotoCliBackend final : public CameraBackend {
+    public:
+        [[nodiscard]] QString name() const override;
+        QString detectCameras(QVector<DetectedCamera>& cameras) override;
+        std::shared_ptr<CameraSession> openSession(const QString& name, int bus, int port) override;
+    };
+
+}
@@ -0,0 +1,91 @@
+#include "gphotoparser.h"
+
+#include <algorithm>
+#include <charconv>
+
+using namespace CamWatcher;
+
+namespace {
+
+    bool isSpace(const char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    std::string_view trimmed(std::string_view s) {
+        while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+        while (!s.empty() && isSpace(s.back())) s.remove_suffix(1);
+        return s;
+    }
+
+    // Next whitespace separated token, consumed from s
+    std::string_view takeToken(std::string_view& s) {
+        s = trimmed(s);
+        const auto end = std::min(s.find_first_of(" \t"), s.size());
+        const auto token = s.substr(0, end);
+        s.remove_prefix(end);
+        return token;
+    }
+
+    template<typename T>
+    bool parseNumber(const std::string_view s, T& value) {
+        const auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+        return ec == std::errc() && ptr == s.data() + s.size();
+    }
+
+}
+
+std::optional<std::string_view> CamWatcher::parseFolderLine(const std::string_view line) {
+    // "There are N files", "There is 1 file" and "There are no files" all end the same way
+    static constexpr std::string_view marker = " in folder '";
+    if (line.substr(0, 6) != "There ")
+        return std::nullopt;
+
+    const auto start = line.find(marker);
+    const auto end = line.rfind('\'');
+    if (start == std::string_view::npos || end == std::string_view::npos || end < start + marker.size())
+        return std::nullopt;
+    return line.substr(start + marker.size(), end - start - marker.size());
+}
+
+std::optional<ListedFileLine> CamWatcher::parseFileLine(std::string_view line) {
+    line = trimmed(line);
+    if (line.empty() || line.front() != '#')
+        return std::nullopt;
+    line.remove_prefix(1);
+
+    int gphotoIndex = 0;
+    if (!parseNumber(takeToken(line), gphotoIndex))
+        return std::nullopt;
+
+    ListedFileLine file{takeToken(line), 0, 0};
+    const auto flags = takeToken(line);
+    if (file.name.empty() || flags.empty())
+        return std::nullopt;
+    if (!parseNumber(takeToken(line), file.kbSize) || takeToken(line) != "KB")
+        return std::nullopt;
+
+    // Media type, maybe dimensions, and the timestamp last
+    line = trimmed(line);
+    const auto lastSpace = line.find_last_of(" \t");
+    const auto last = lastSpace == std::string_view::npos ? line : line.substr(lastSpace + 1);
+    if (!parseNumber(last, file.timestamp))
+        file.timestamp = 0;
+    return file;
+}
+
+std::optional<AutoDetectLine> CamWatcher::parseAutoDetectLine(std::string_view line) {
+    line = trimmed(line);
+    // "usb:BBB,DDD" at the end, the model name before it
+    static constexpr size_t portLength = 11;
+    if (line.size() <= portLength)
+        return std::nullopt;
+    const auto port = line.substr(line.size() - portLength);
+    if (port.substr(0, 4) != "usb:" || port[7] != ',')
+        return std::nullopt;
+
+    AutoDetectLine camera{trimmed(line.substr(0, line.size() - portLength)), 0, 0};
+    if (camera.name.empty() || !parseNumber(port.substr(4, 3), camera.bus) ||
+        !parseNumber(port.substr(8, 3), camera.port))
+        return std::nullopt;
+    return camera;
+}
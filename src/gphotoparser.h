@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QtGlobal>
+#include <optional>
+#include <string_view>
+
+namespace CamWatcher {
+
+    /*
+     * Parsers for gphoto2 command line output, working on the raw bytes without allocating.
+     * Returned views point into the line passed in.
+     */
+
+    struct ListedFileLine {
+        std::string_view name;
+        int kbSize;
+        // 0 if missing
+        qint64 timestamp;
+    };
+
+    struct AutoDetectLine {
+        std::string_view name;
+        int bus;
+        int port;
+    };
+
+    // "There are 12 files in folder '/store_00010001/DCIM/100CANON'." gives the folder
+    std::optional<std::string_view> parseFolderLine(std::string_view line);
+    // "#1     IMG_0001.JPG               rd  5836 KB 6000x4000 image/jpeg 1600000000"
+    std::optional<ListedFileLine> parseFileLine(std::string_view line);
+    // "Canon EOS 80D                  usb:001,005"
+    std::optional<AutoDetectLine> parseAutoDetectLine(std::string_view line);
+
+    // Hand each complete line in data to onLine, returns the number of bytes used (the unterminated tail is not)
+    template<typename F>
+    size_t forEachLine(const std::string_view data, const F& onLine) {
+        size_t start = 0;
+        for (size_t end; (end = data.find('\n', start)) != std::string_view::npos; start = end + 1) {
+            auto line = data.substr(start, end - start);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            onLine(line);
+        }
+        return start;
+    }
+
+}
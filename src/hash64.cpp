@@ -0,0 +1,148 @@
+#include "hash64.h"
+
+#include <cstring>
+
+using namespace CamWatcher;
+
+namespace {
+
+    constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+    inline uint64_t rotl(const uint64_t x, const int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // Little endian loads, the compiler turns these into plain moves
+    inline uint64_t read64(const unsigned char* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap64(v);
+#endif
+        return v;
+    }
+
+    inline uint32_t read32(const unsigned char* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap32(v);
+#endif
+        return v;
+    }
+
+    inline uint64_t round(uint64_t acc, const uint64_t input) {
+        acc += input * prime2;
+        acc = rotl(acc, 31);
+        return acc * prime1;
+    }
+
+    inline uint64_t mergeRound(uint64_t acc, const uint64_t lane) {
+        acc ^= round(0, lane);
+        return acc * prime1 + prime4;
+    }
+
+}
+
+Hash64::Hash64(const uint64_t seed) {
+    reset(seed);
+}
+
+void Hash64::reset(const uint64_t seed) {
+    mSeed = seed;
+    mLanes[0] = seed + prime1 + prime2;
+    mLanes[1] = seed + prime2;
+    mLanes[2] = seed;
+    mLanes[3] = seed - prime1;
+    mTotalSize = 0;
+    mBufferSize = 0;
+}
+
+void Hash64::update(const void* data, size_t size) {
+    auto p = static_cast<const unsigned char*>(data);
+    mTotalSize += size;
+
+    if (mBufferSize + size < 32) {
+        std::memcpy(mBuffer + mBufferSize, p, size);
+        mBufferSize += size;
+        return;
+    }
+
+    if (mBufferSize) {
+        const size_t fill = 32 - mBufferSize;
+        std::memcpy(mBuffer + mBufferSize, p, fill);
+        for (int i = 0; i < 4; i++) mLanes[i] = round(mLanes[i], read64(mBuffer + i * 8));
+        p += fill;
+        size -= fill;
+        mBufferSize = 0;
+    }
+
+    uint64_t v1 = mLanes[0];
+    uint64_t v2 = mLanes[1];
+    uint64_t v3 = mLanes[2];
+    uint64_t v4 = mLanes[3];
+    while (size >= 32) {
+        v1 = round(v1, read64(p));
+        v2 = round(v2, read64(p + 8));
+        v3 = round(v3, read64(p + 16));
+        v4 = round(v4, read64(p + 24));
+        p += 32;
+        size -= 32;
+    }
+    mLanes[0] = v1;
+    mLanes[1] = v2;
+    mLanes[2] = v3;
+    mLanes[3] = v4;
+
+    std::memcpy(mBuffer, p, size);
+    mBufferSize = size;
+}
+
+uint64_t Hash64::digest() const {
+    uint64_t h;
+    if (mTotalSize >= 32) {
+        h = rotl(mLanes[0], 1) + rotl(mLanes[1], 7) + rotl(mLanes[2], 12) + rotl(mLanes[3], 18);
+        for (const auto lane: mLanes) h = mergeRound(h, lane);
+    } else {
+        h = mSeed + prime5;
+    }
+    h += mTotalSize;
+
+    const unsigned char* p = mBuffer;
+    size_t size = mBufferSize;
+    while (size >= 8) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+        p += 8;
+        size -= 8;
+    }
+    if (size >= 4) {
+        h ^= static_cast<uint64_t>(read32(p)) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+        size -= 4;
+    }
+    while (size > 0) {
+        h ^= (*p) * prime5;
+        h = rotl(h, 11) * prime1;
+        p++;
+        size--;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t Hash64::hash(const void* data, const size_t size, const uint64_t seed) {
+    Hash64 hasher(seed);
+    hasher.update(data, size);
+    return hasher.digest();
+}
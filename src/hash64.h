@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace CamWatcher {
+
+    /**
+     * Streaming XXH64. Four independent accumulator lanes per 32 byte stripe keep the cpu's pipelines full,
+     * so it runs well above disk speed on anything we care about, and hashes are checkable with `xxhsum -H1`.
+     */
+    class Hash64 {
+    public:
+        explicit Hash64(uint64_t seed = 0);
+
+        void reset(uint64_t seed = 0);
+        void update(const void* data, size_t size);
+        [[nodiscard]] uint64_t digest() const;
+
+        static uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+
+    private:
+        uint64_t mSeed;
+        uint64_t mLanes[4];
+        uint64_t mTotalSize;
+        unsigned char mBuffer[32];
+        size_t mBufferSize;
+    };
+
+}
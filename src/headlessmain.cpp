@@ -0,0 +1,37 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTimer>
+
+#include "autoimporter.h"
+#include "procstats.h"
+#include "usbmanager.h"
+
+// Imports from cameras as they are plugged in, without a gui (eg: an ingest station without a screen)
+int main(int argc, char* argv[]) {
+    // The same settings as the gui, so cameras keep the destinations set up there
+    QCoreApplication::setApplicationName("CameraWatcher");
+    QCoreApplication::setOrganizationName("CoreSmith");
+
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Copies or moves files off cameras as soon as they are plugged in");
+    parser.addHelpOption();
+    const QCommandLineOption destOption("dest", "Destination for cameras that don't have one yet.", "dir");
+    const QCommandLineOption moveOption("move", "Delete files from cameras once imported, unless set per camera.");
+    const QCommandLineOption manualOption("manual", "Only import cameras that have auto import set.");
+    parser.addOptions({destOption, moveOption, manualOption});
+    parser.process(a);
+
+    auto mode = parser.isSet(moveOption) ? CamWatcher::AutoImporter::Move : CamWatcher::AutoImporter::Copy;
+    if (parser.isSet(manualOption))
+        mode = CamWatcher::AutoImporter::Off;
+
+    CamWatcher::UsbManager usbManager;
+    CamWatcher::AutoImporter importer(usbManager, parser.value(destOption), mode);
+
+    // Once the event loop runs, cameras found at startup are being listed by then
+    QTimer::singleShot(0, [] { CamWatcher::logProcStats("Started"); });
+
+    return QCoreApplication::exec();
+}
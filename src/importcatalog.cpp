@@ -0,0 +1,177 @@
+#include "importcatalog.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtDebug>
+
+using namespace CamWatcher;
+
+namespace {
+    constexpr quint32 catalogMagic = 0x43574354;// "CWCT"
+    constexpr quint32 catalogVersion = 1;
+}
+
+ImportCatalog::ImportCatalog(QString identity) : mIdentity(std::move(identity)) {}
+
+const QString& ImportCatalog::identity() const {
+    return mIdentity;
+}
+
+QString ImportCatalog::filePath() const {
+    const auto dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/catalogs";
+    const auto hash = QCryptographicHash::hash(mIdentity.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return dir + '/' + hash + ".catalog";
+}
+
+bool ImportCatalog::load() {
+    QFile file(filePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    if (magic != catalogMagic || version != catalogVersion) {
+        qWarning() << "Ignoring catalog with unknown format:" << file.fileName();
+        return false;
+    }
+
+    QString identity;
+    qint64 lastImport = 0;
+    qint32 count = 0;
+    in >> identity >> lastImport >> count;
+
+    FileCatalog::Builder builder;
+    builder.reserve(count);
+    std::vector<qint64> importedAt;
+    importedAt.reserve(count);
+    for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        QString path;
+        qint32 kbSize = 0;
+        qint64 timestamp = 0;
+        qint64 imported = 0;
+        in >> path >> kbSize >> timestamp >> imported;
+        builder.append(path, kbSize, timestamp);
+        importedAt.push_back(imported);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "Corrupt catalog:" << file.fileName();
+        return false;
+    }
+
+    mFiles = builder.build();
+    mImportedAt = std::move(importedAt);
+    mRemoved.assign(mImportedAt.size(), false);
+    mRemovedCount = 0;
+    mLastImport = lastImport;
+    qDebug() << "Loaded catalog of" << mFiles->size() << "files," << mFiles->memoryUsage() / 1024 << "KB";
+    return true;
+}
+
+bool ImportCatalog::save() const {
+    const auto path = filePath();
+    if (!QDir().mkpath(QFileInfo(path).path()))
+        return false;
+
+    // Write to a temp file and rename, a crash never leaves half a catalog behind
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to save catalog:" << path << file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << catalogMagic << catalogVersion << mIdentity << mLastImport
+        << static_cast<qint32>(mFiles->size() - mRemovedCount);
+    for (int i = 0; i < mFiles->size(); i++) {
+        if (mRemoved[i])
+            continue;
+        out << mFiles->filePath(i) << static_cast<qint32>(mFiles->kbSize(i)) << mFiles->timestamp(i)
+            << mImportedAt[i];
+    }
+    return file.commit();
+}
+
+FileSnapshot ImportCatalog::files() const {
+    return mFiles;
+}
+
+bool ImportCatalog::isEmpty() const {
+    return mFiles->size() == mRemovedCount;
+}
+
+void ImportCatalog::update(const FileSnapshot& files) {
+    std::vector<qint64> importedAt(files->size(), 0);
+    for (int i = 0; i < files->size(); i++) {
+        const auto old = mFiles->indexOf(files->filePath(i));
+        // Same name but a different size or date means the card was reused, treat it as a new file
+        if (old >= 0 && !mRemoved[old] && mFiles->kbSize(old) == files->kbSize(i) &&
+            mFiles->timestamp(old) == files->timestamp(i))
+            importedAt[i] = mImportedAt[old];
+    }
+
+    mFiles = files;
+    mImportedAt = std::move(importedAt);
+    mRemoved.assign(mImportedAt.size(), false);
+    mRemovedCount = 0;
+}
+
+void ImportCatalog::markImported(const QString& filePath) {
+    const auto now = QDateTime::currentSecsSinceEpoch();
+    mLastImport = now;
+    if (const auto i = mFiles->indexOf(filePath); i >= 0)
+        mImportedAt[i] = now;
+}
+
+void ImportCatalog::remove(const QString& filePath) {
+    const auto i = mFiles->indexOf(filePath);
+    if (i < 0 || mRemoved[i])
+        return;
+    mRemoved[i] = true;
+    mRemovedCount++;
+}
+
+void ImportCatalog::compact() {
+    if (!mRemovedCount)
+        return;
+
+    FileCatalog::Builder builder;
+    builder.reserve(mFiles->size() - mRemovedCount);
+    std::vector<qint64> importedAt;
+    importedAt.reserve(mFiles->size() - mRemovedCount);
+    for (int i = 0; i < mFiles->size(); i++) {
+        if (mRemoved[i])
+            continue;
+        builder.append(*mFiles, i);
+        importedAt.push_back(mImportedAt[i]);
+    }
+
+    mFiles = builder.build();
+    mImportedAt = std::move(importedAt);
+    mRemoved.assign(mImportedAt.size(), false);
+    mRemovedCount = 0;
+}
+
+bool ImportCatalog::isImported(const int index) const {
+    return mImportedAt[index] > 0;
+}
+
+int ImportCatalog::newFileCount() const {
+    int count = 0;
+    for (int i = 0; i < mFiles->size(); i++) {
+        if (!mRemoved[i] && mImportedAt[i] == 0)
+            count++;
+    }
+    return count;
+}
+
+qint64 ImportCatalog::lastImport() const {
+    return mLastImport;
+}
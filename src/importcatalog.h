@@ -0,0 +1,49 @@
+#pragma once
+
+#include "filecatalog.h"
+
+#include <QString>
+#include <vector>
+
+namespace CamWatcher {
+
+    /**
+     * What we last saw on a camera and which of those files were imported, persisted between sessions.
+     * Keyed by a stable camera identity (USB vendor/product/serial) rather than the display name.
+     * Not thread safe: loaded off the gui thread, then handed to it and used there only.
+     */
+    class ImportCatalog {
+    public:
+        explicit ImportCatalog(QString identity);
+
+        [[nodiscard]] const QString& identity() const;
+        [[nodiscard]] QString filePath() const;
+        bool load();
+        bool save() const;
+
+        // Includes files removed since the last compact()
+        [[nodiscard]] FileSnapshot files() const;
+        [[nodiscard]] bool isEmpty() const;
+        // Replace the known files with a fresh listing, files that did not change keep their import status
+        void update(const FileSnapshot& files);
+        void markImported(const QString& filePath);
+        // Gone from the camera, dropped from files() by the next compact()
+        void remove(const QString& filePath);
+        void compact();
+        // By row of files()
+        [[nodiscard]] bool isImported(int index) const;
+        [[nodiscard]] int newFileCount() const;
+        // Time (seconds since epoch) of the last import from this camera, 0 if never
+        [[nodiscard]] qint64 lastImport() const;
+
+    private:
+        QString mIdentity;
+        FileSnapshot mFiles = FileCatalog::empty();
+        // Columns next to mFiles, 0 when not imported
+        std::vector<qint64> mImportedAt;
+        std::vector<bool> mRemoved;
+        int mRemovedCount = 0;
+        qint64 mLastImport = 0;
+    };
+
+}
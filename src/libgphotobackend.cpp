@@ -0,0 +1,418 @@
+#include "libgphotobackend.h"
+
+#ifdef CAMWATCHER_WITH_LIBGPHOTO2
+
+#include "sysfs.h"
+#include "utils.h"
+
+#include <QHash>
+#include <QtDebug>
+#include <gphoto2/gphoto2.h>
+#include <mutex>
+#include <vector>
+
+using namespace CamWatcher;
+
+namespace {
+
+    constexpr uint64_t readChunkSize = 1 << 20;
+
+    QString gpError(const QString& what, const int ret) {
+        return QString("%1: %2").arg(what, gp_result_as_string(ret));
+    }
+
+    QString joinCameraPath(const QString& folder, const QString& name) {
+        return folder.endsWith('/') ? folder + name : folder + '/' + name;
+    }
+
+    QPair<QByteArray, QByteArray> splitCameraPath(const QString& cameraPath) {
+        const auto idx = cameraPath.lastIndexOf('/');
+        const auto folder = idx > 0 ? cameraPath.left(idx) : QString("/");
+        return {folder.toUtf8(), cameraPath.mid(idx + 1).toUtf8()};
+    }
+
+    // Point the camera at usb:bus,port. The port list is loaded fresh, cameras plugged in since the last load are
+    // missing from an older one, and without the right port libgphoto2 picks any camera it finds.
+    QString setCameraPort(Camera* camera, const QString& portPath) {
+        GPPortInfoList* ports = nullptr;
+        gp_port_info_list_new(&ports);
+        QString err;
+        if (const int ret = gp_port_info_list_load(ports); ret < GP_OK) {
+            err = gpError("Failed to list ports", ret);
+        } else if (const int portIdx = gp_port_info_list_lookup_path(ports, portPath.toUtf8()); portIdx < GP_OK) {
+            err = QString("Camera port %1 not found").arg(portPath);
+        } else {
+            GPPortInfo portInfo;
+            gp_port_info_list_get_info(ports, portIdx, &portInfo);
+            if (const int setRet = gp_camera_set_port_info(camera, portInfo); setRet < GP_OK)
+                err = gpError("Failed to use port " + portPath, setRet);
+        }
+        gp_port_info_list_free(ports);
+        return err;
+    }
+
+    // Lets the camera driver abort the transfer it is in the middle of once cancelled, for as long as it's in scope
+    class CancelScope {
+    public:
+        CancelScope(GPContext* context, CancelToken cancel) : mContext(context), mCancel(std::move(cancel)) {
+            gp_context_set_cancel_func(mContext, &CancelScope::check, this);
+        }
+
+        ~CancelScope() {
+            gp_context_set_cancel_func(mContext, nullptr, nullptr);
+        }
+
+        CancelScope(const CancelScope&) = delete;
+        CancelScope& operator=(const CancelScope&) = delete;
+
+    private:
+        static GPContextFeedback check(GPContext*, void* data) {
+            return static_cast<CancelScope*>(data)->mCancel.isCancelled() ? GP_CONTEXT_FEEDBACK_CANCEL
+                                                                           : GP_CONTEXT_FEEDBACK_OK;
+        }
+
+        GPContext* mContext;
+        const CancelToken mCancel;
+    };
+
+    class LibGPhotoSession final : public CameraSession {
+    public:
+        LibGPhotoSession(Camera* camera, GPContext* context, QString portPath)
+            : mCamera(camera), mContext(context), mPortPath(std::move(portPath)) {}
+
+        ~LibGPhotoSession() override {
+            if (mInitialized)
+                gp_camera_exit(mCamera, mContext);
+            gp_camera_unref(mCamera);
+            gp_context_unref(mContext);
+        }
+
+        QString listFiles(const FileBatchSink& sink) override {
+            std::lock_guard lock(mMutex);
+            if (auto err = ensureInitialized(); !err.isEmpty())
+                return err;
+            return listFolder("/", sink);
+        }
+
+        QString readFile(const QString& cameraPath, const qint64 offset, const DataSink& sink,
+                         const CancelToken& cancel) override {
+            std::lock_guard lock(mMutex);
+            if (auto err = ensureInitialized(); !err.isEmpty())
+                return err;
+            // Also covers the whole file fallback, which is one long call
+            CancelScope cancelScope(mContext, cancel);
+
+            const auto [folder, name] = splitCameraPath(cameraPath);
+
+            uint64_t fileSize = 0;
+            CameraFileInfo info;
+            if (gp_camera_file_get_info(mCamera, folder, name, &info, mContext) >= GP_OK &&
+                (info.file.fields & GP_FILE_INFO_SIZE))
+                fileSize = info.file.size;
+
+            std::vector<char> buffer(readChunkSize);
+            uint64_t pos = offset;
+            while (fileSize == 0 || pos < fileSize) {
+                uint64_t size = buffer.size();
+                const int ret = gp_camera_file_read(mCamera, folder, name, GP_FILE_TYPE_NORMAL, pos, buffer.data(),
+                                                    &size, mContext);
+                if (ret == GP_ERROR_NOT_SUPPORTED && pos == static_cast<uint64_t>(offset))
+                    return readWholeFile(folder, name, offset, sink);
+                if (ret == GP_ERROR_CANCEL || cancel.isCancelled())
+                    return "Cancelled";
+                if (ret < GP_OK)
+                    return gpError("Failed to read " + cameraPath, ret);
+                if (size == 0)
+                    break;
+                if (!sink(buffer.data(), static_cast<qint64>(size)))
+                    return "Transfer aborted";
+                pos += size;
+            }
+            return {};
+        }
+
+        QString deleteFile(const QString& cameraPath) override {
+            std::lock_guard lock(mMutex);
+            if (auto err = ensureInitialized(); !err.isEmpty())
+                return err;
+
+            const auto [folder, name] = splitCameraPath(cameraPath);
+            if (const int ret = gp_camera_file_delete(mCamera, folder, name, mContext); ret < GP_OK)
+                return gpError("Failed to delete " + cameraPath, ret);
+            return {};
+        }
+
+        // One lock for the batch, so no reads get in between
+        QString deleteFiles(const QString& folder, const QStringList& fileNames, int& deleted) override {
+            std::lock_guard lock(mMutex);
+            deleted = 0;
+            if (auto err = ensureInitialized(); !err.isEmpty())
+                return err;
+
+            for (const auto& fileName: fileNames) {
+                const auto [folderName, name] = splitCameraPath(folder + fileName);
+                if (const int ret = gp_camera_file_delete(mCamera, folderName, name, mContext); ret < GP_OK)
+                    return gpError("Failed to delete " + folder + fileName, ret);
+                deleted++;
+            }
+            return {};
+        }
+
+        [[nodiscard]] bool supportsRangeReads() const override {
+            return true;
+        }
+
+        QString fileSize(const QString& cameraPath, qint64& bytes) override {
+            std::lock_guard lock(mMutex);
+            if (auto err = ensureInitialized(); !err.isEmpty())
+                return err;
+
+            const auto [folder, name] = splitCameraPath(cameraPath);
+            CameraFileInfo info;
+            if (const int ret = gp_camera_file_get_info(mCamera, folder, name, &info, mContext); ret < GP_OK)
+                return gpError("Failed to get info for " + cameraPath, ret);
+            if (!(info.file.fields & GP_FILE_INFO_SIZE))
+                return "Camera did not report a size for " + cameraPath;
+            bytes = static_cast<qint64>(info.file.size);
+            return {};
+        }
+
+        QString readRange(const QString& cameraPath, const qint64 offset, const qint64 length,
+                          QByteArray& data) override {
+            std::lock_guard lock(mMutex);
+            if (auto err = ensureInitialized(); !err.isEmpty())
+                return err;
+
+            const auto [folder, name] = splitCameraPath(cameraPath);
+            data.resize(static_cast<int>(length));
+            uint64_t size = length;
+            const int ret = gp_camera_file_read(mCamera, folder, name, GP_FILE_TYPE_NORMAL, offset, data.data(),
+                                                &size, mContext);
+            if (ret < GP_OK)
+                return gpError("Failed to read " + cameraPath, ret);
+            data.resize(static_cast<int>(size));
+            return {};
+        }
+
+        QString readThumbnail(const QString& cameraPath, QByteArray& data, const CancelToken& cancel) override {
+            std::lock_guard lock(mMutex);
+            if (cancel.isCancelled())
+                return "Cancelled";
+            if (auto err = ensureInitialized(); !err.isEmpty())
+                return err;
+            CancelScope cancelScope(mContext, cancel);
+
+            const auto [folder, name] = splitCameraPath(cameraPath);
+            CameraFile* file = nullptr;
+            gp_file_new(&file);
+
+            QString err;
+            if (const int ret = gp_camera_file_get(mCamera, folder, name, GP_FILE_TYPE_PREVIEW, file, mContext);
+                ret < GP_OK) {
+                err = gpError("Failed to get thumbnail of " + cameraPath, ret);
+            } else {
+                const char* fileData = nullptr;
+                unsigned long size = 0;
+                gp_file_get_data_and_size(file, &fileData, &size);
+                data = QByteArray(fileData, static_cast<int>(size));
+            }
+
+            gp_file_unref(file);
+            return err;
+        }
+
+    private:
+        QString ensureInitialized() {
+            if (mInitialized)
+                return {};
+            if (auto err = setCameraPort(mCamera, mPortPath); !err.isEmpty())
+                return err;
+            if (const int ret = gp_camera_init(mCamera, mContext); ret < GP_OK)
+                return gpError("Failed to open camera", ret);
+            mInitialized = true;
+            return {};
+        }
+
+        // Recursively list folder, every folder's files go out as one batch
+        QString listFolder(const QString& folder, const FileBatchSink& sink) {
+            const auto folderUtf8 = folder.toUtf8();
+
+            CameraList* list = nullptr;
+            gp_list_new(&list);
+
+            int ret = gp_camera_folder_list_files(mCamera, folderUtf8, list, mContext);
+            if (ret < GP_OK) {
+                gp_list_free(list);
+                return gpError("Failed to list " + folder, ret);
+            }
+
+            QVector<UsbFile> files;
+            for (int i = 0; i < gp_list_count(list); i++) {
+                const char* name = nullptr;
+                gp_list_get_name(list, i, &name);
+
+                int kbSize = 0;
+                qint64 timestamp = 0;
+                CameraFileInfo info;
+                if (gp_camera_file_get_info(mCamera, folderUtf8, name, &info, mContext) >= GP_OK) {
+                    if (info.file.fields & GP_FILE_INFO_SIZE)
+                        kbSize = static_cast<int>(info.file.size / 1024);
+                    if (info.file.fields & GP_FILE_INFO_MTIME)
+                        timestamp = info.file.mtime;
+                }
+
+                files.append({joinCameraPath(folder, QString::fromUtf8(name)), kbSize, timestamp});
+            }
+            if (!files.isEmpty())
+                sink(files);
+
+            gp_list_reset(list);
+            ret = gp_camera_folder_list_folders(mCamera, folderUtf8, list, mContext);
+            if (ret < GP_OK) {
+                gp_list_free(list);
+                return gpError("Failed to list " + folder, ret);
+            }
+
+            QStringList subFolders;
+            for (int i = 0; i < gp_list_count(list); i++) {
+                const char* name = nullptr;
+                gp_list_get_name(list, i, &name);
+                subFolders << joinCameraPath(folder, QString::fromUtf8(name));
+            }
+            gp_list_free(list);
+
+            for (const auto& subFolder: subFolders) {
+                if (auto err = listFolder(subFolder, sink); !err.isEmpty())
+                    return err;
+            }
+            return {};
+        }
+
+        QString readWholeFile(const char* folder, const char* name, const qint64 offset, const DataSink& sink) {
+            CameraFile* file = nullptr;
+            gp_file_new(&file);
+
+            QString err;
+            if (const int ret = gp_camera_file_get(mCamera, folder, name, GP_FILE_TYPE_NORMAL, file, mContext);
+                ret < GP_OK) {
+                err = gpError(QString("Failed to read %1/%2").arg(folder, name), ret);
+            } else {
+                const char* data = nullptr;
+                unsigned long size = 0;
+                gp_file_get_data_and_size(file, &data, &size);
+                const auto skip = qMin(offset, static_cast<qint64>(size));
+                if (!sink(data + skip, static_cast<qint64>(size) - skip))
+                    err = "Transfer aborted";
+            }
+
+            gp_file_unref(file);
+            return err;
+        }
+
+        Camera* mCamera;
+        GPContext* mContext;
+        const QString mPortPath;
+        bool mInitialized = false;
+        std::mutex mMutex;
+    };
+
+    // Loading these scans all camera drivers, do it once per process. Ports come and go, they are not kept.
+    struct GPhotoLists {
+        CameraAbilitiesList* abilities = nullptr;
+        // Model names by USB vendor and product id
+        QHash<quint32, QString> usbModels;
+        std::mutex mutex;
+    };
+
+    quint32 usbId(const int vendor, const int product) {
+        return static_cast<quint32>(vendor) << 16 | static_cast<quint32>(product);
+    }
+
+    GPhotoLists& gphotoLists() {
+        static GPhotoLists lists;
+        static std::once_flag loaded;
+        std::call_once(loaded, [] {
+            gp_abilities_list_new(&lists.abilities);
+            gp_abilities_list_load(lists.abilities, nullptr);
+
+            for (int i = 0; i < gp_abilities_list_count(lists.abilities); i++) {
+                CameraAbilities abilities;
+                gp_abilities_list_get_abilities(lists.abilities, i, &abilities);
+                if (abilities.usb_vendor)
+                    lists.usbModels.insert(usbId(abilities.usb_vendor, abilities.usb_product), abilities.model);
+            }
+        });
+        return lists;
+    }
+
+}
+
+QString LibGPhotoBackend::name() const {
+    return "libgphoto2";
+}
+
+QString LibGPhotoBackend::detectCameras(QVector<DetectedCamera>& cameras) {
+    GPContext* context = gp_context_new();
+    CameraList* list = nullptr;
+    gp_list_new(&list);
+
+    // Loads the port list anew every time, so cameras plugged in since the last call are found
+    const int ret = gp_camera_autodetect(list, context);
+    if (ret < GP_OK) {
+        gp_list_free(list);
+        gp_context_unref(context);
+        return gpError("Failed to detect cameras", ret);
+    }
+
+    for (int i = 0; i < gp_list_count(list); i++) {
+        const char* name = nullptr;
+        const char* value = nullptr;
+        gp_list_get_name(list, i, &name);
+        gp_list_get_value(list, i, &value);
+
+        int bus = 0;
+        int port = 0;
+        if (!parsePortPath(QString::fromUtf8(value), bus, port))
+            continue;
+        cameras.append({QString::fromUtf8(name), bus, port});
+    }
+
+    gp_list_free(list);
+    gp_context_unref(context);
+    return {};
+}
+
+QString LibGPhotoBackend::detectCamera(const int bus, const int port, std::optional<DetectedCamera>& camera) {
+    camera.reset();
+    const auto dev = findSysfsUsbDevice(bus, port);
+    if (!dev)
+        return {};
+
+    // Same matching gp_camera_autodetect does, from sysfs instead of opening every USB device
+    auto& lists = gphotoLists();
+    const auto model = lists.usbModels.value(usbId(dev->vendorId(), dev->productId()));
+    if (!model.isEmpty())
+        camera = DetectedCamera{model, bus, port};
+    else if (dev->interfaceClasses().contains(0x06)) // Still image class, any PTP camera
+        camera = DetectedCamera{"USB PTP Class Camera", bus, port};
+    return {};
+}
+
+std::shared_ptr<CameraSession> LibGPhotoBackend::openSession(const QString& name, const int bus, const int port) {
+    auto& lists = gphotoLists();
+    std::lock_guard lock(lists.mutex);
+
+    Camera* camera = nullptr;
+    gp_camera_new(&camera);
+
+    if (const int model = gp_abilities_list_lookup_model(lists.abilities, name.toUtf8()); model >= GP_OK) {
+        CameraAbilities abilities;
+        gp_abilities_list_get_abilities(lists.abilities, model, &abilities);
+        gp_camera_set_abilities(camera, abilities);
+    }
+
+    // The port is looked up when the session is first used, a missing one is an error then
+    return std::make_shared<LibGPhotoSession>(camera, gp_context_new(), createPortPath(bus, port));
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "camerabackend.h"
+
+#ifdef CAMWATCHER_WITH_LIBGPHOTO2
+
+namespace CamWatcher {
+
+    /**
+     * Talks to cameras in-process through libgphoto2.
+     * Every session keeps its Camera* (and so its PTP session) open until the device goes away.
+     */
+    class LibGPhotoBackend final : public CameraBackend {
+    public:
+        [[nodiscard]] QString name() const override;
+        QString detectCameras(QVector<DetectedCamera>& cameras) override;
+        QString detectCamera(int bus, int port, std::optional<DetectedCamera>& camera) override;
+        std::shared_ptr<CameraSession> openSession(const QString& name, int bus, int port) override;
+    };
+
+}
+
+#endif
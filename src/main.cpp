@@ -4,7 +4,6 @@
 #include "usbmanager.h"
 
 #include <QFontDatabase>
-#include <libudev.h>
 
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,43 @@
+#include "mainthreadqueue.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <vector>
+
+using namespace CamWatcher;
+
+MainThreadQueue& MainThreadQueue::instance() {
+    static MainThreadQueue queue;
+    return queue;
+}
+
+void MainThreadQueue::post(const void* coalesceKey, std::function<void()> func) {
+    // any thread
+    auto node = new Node{std::move(func), coalesceKey, mHead.load(std::memory_order_relaxed)};
+    while (!mHead.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+
+    if (!mDrainPending.exchange(true))
+        QMetaObject::invokeMethod(qApp, [this] { drain(); }, Qt::QueuedConnection);
+}
+
+void MainThreadQueue::drain() {
+    // main thread
+    // Clear the flag before taking the batch, anything posted after this schedules another drain
+    mDrainPending.store(false);
+    Node* node = mHead.exchange(nullptr, std::memory_order_acquire);
+
+    std::vector<Node*> batch;
+    for (; node; node = node->next) batch.push_back(node);
+
+    // Oldest first, a keyed function runs where the last one with its key was posted
+    QHash<const void*, Node*> latest;
+    for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+        if ((*it)->key)
+            latest.insert((*it)->key, *it);
+    }
+    for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+        if (!(*it)->key || latest.value((*it)->key) == *it)
+            (*it)->func();
+        delete *it;
+    }
+}
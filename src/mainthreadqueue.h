@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+namespace CamWatcher {
+
+    /**
+     * Functions posted from any thread, run on the main thread in batches.
+     * Posting is lock free; only the first post after a batch was picked up wakes the event loop.
+     * Functions posted with a key replace any not yet run with the same key, so a burst of progress
+     * updates for one device costs the gui a single update.
+     */
+    class MainThreadQueue {
+    public:
+        static MainThreadQueue& instance();
+
+        void post(const void* coalesceKey, std::function<void()> func);
+
+    private:
+        struct Node {
+            std::function<void()> func;
+            const void* key;
+            Node* next;
+        };
+
+        void drain();
+
+        // Most recently posted first
+        std::atomic<Node*> mHead = nullptr;
+        std::atomic<bool> mDrainPending = false;
+    };
+
+}
@@ -0,0 +1,41 @@
+#include "manifest.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QtDebug>
+#include <unistd.h>
+
+using namespace CamWatcher;
+
+Manifest::Manifest(QString dirPath)
+    : mDirPath(std::move(dirPath)),
+      mFile(QString("%1/camerawatcher-%2.xxh64")
+                    .arg(mDirPath, QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"))) {}
+
+Manifest::~Manifest() {
+    close();
+}
+
+QString Manifest::add(const QString& filePath, const quint64 hash) {
+    std::lock_guard lock(mMutex);
+    if (!mFile.isOpen() && !mFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        return QString("Failed to open %1: %2").arg(mFile.fileName(), mFile.errorString());
+
+    const auto line = formatHash(hash) + "  " + QDir(mDirPath).relativeFilePath(filePath) + '\n';
+    if (mFile.write(line.toUtf8()) < 0)
+        return QString("Failed to write %1: %2").arg(mFile.fileName(), mFile.errorString());
+    return {};
+}
+
+void Manifest::close() {
+    std::lock_guard lock(mMutex);
+    if (!mFile.isOpen())
+        return;
+    mFile.flush();
+    ::fdatasync(mFile.handle());
+    mFile.close();
+}
+
+QString Manifest::formatHash(const quint64 hash) {
+    return QString("%1").arg(hash, 16, 16, QChar('0'));
+}
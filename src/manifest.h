@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <mutex>
+
+namespace CamWatcher {
+
+    /**
+     * The hashes of the files an import put in a directory, one "hash  path" line per file with paths relative to
+     * the directory, the format `xxhsum -H1 -c` reads. Lets a later audit re-verify an archive without the camera.
+     * Created on the first file, so imports that copied nothing leave nothing behind. Thread safe.
+     */
+    class Manifest {
+    public:
+        explicit Manifest(QString dirPath);
+        ~Manifest();
+
+        QString add(const QString& filePath, quint64 hash);
+        // Make it durable
+        void close();
+
+        [[nodiscard]] static QString formatHash(quint64 hash);
+
+    private:
+        const QString mDirPath;
+        QFile mFile;
+        std::mutex mMutex;
+    };
+
+}
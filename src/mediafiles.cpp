@@ -0,0 +1,97 @@
+#include "mediafiles.h"
+
+#include <array>
+
+using namespace CamWatcher;
+
+namespace {
+
+    constexpr std::string_view mediaExtensions[] = {
+            // Images and raw formats
+            "png", "jpg", "jpeg", "gif", "3fr", "ari", "arw", "bay", "braw", "cri", "crw", "cap", "dcs", "dng",
+            "erf", "fff", "gpr", "jxs", "mef", "mdc", "mos", "mrw", "nef", "orf", "pef", "pxn", "r3d", "raf",
+            "raw", "rwz", "srw", "tco", "x3f",
+            // Video
+            "webm", "mkv", "flv", "vob", "ogv", "ogg", "rrc", "gifv", "mng", "mov", "avi", "qt", "wmv", "yuv",
+            "rm", "asf", "amv", "mp4", "m4p", "m4v", "mpg", "mp2", "mpeg", "mpe", "mpv", "svi", "3gp", "3g2",
+            "mxf", "roq", "nsv", "f4v", "f4p", "f4a", "f4b", "mod",
+    };
+
+    // Extensions are packed into an int, so no extension can be longer than this
+    constexpr int maxExtensionLength = 4;
+    constexpr int tableBits = 9;
+    constexpr int tableSize = 1 << tableBits;
+
+    // Lower case bytes of the extension, first one in the low byte. 0 never is an extension.
+    constexpr quint32 extensionKey(const std::string_view ext) {
+        quint32 key = 0;
+        for (size_t i = 0; i < ext.size(); i++) {
+            auto c = static_cast<unsigned char>(ext[i]);
+            if (c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+            key |= static_cast<quint32>(c) << (8 * i);
+        }
+        return key;
+    }
+
+    constexpr quint32 slotOf(const quint32 key, const quint32 multiplier) {
+        return (key * multiplier) >> (32 - tableBits);
+    }
+
+    struct ExtensionTable {
+        quint32 multiplier = 0;
+        std::array<quint32, tableSize> keys{};
+    };
+
+    // Try multipliers until every extension lands in its own slot, a lookup is then a multiply and a compare.
+    // Runs at compile time, a duplicate in the list never resolves and fails the build.
+    constexpr ExtensionTable buildExtensionTable() {
+        for (quint32 multiplier = 0x9E3779B1u;; multiplier += 0xD413CCCEu) {
+            ExtensionTable table{multiplier, {}};
+            bool collision = false;
+            for (const auto ext: mediaExtensions) {
+                auto& slot = table.keys[slotOf(extensionKey(ext), multiplier)];
+                if (slot) {
+                    collision = true;
+                    break;
+                }
+                slot = extensionKey(ext);
+            }
+            if (!collision)
+                return table;
+        }
+    }
+
+    constexpr ExtensionTable extensionTable = buildExtensionTable();
+
+    bool isMediaExtensionKey(const quint32 key) {
+        return extensionTable.keys[slotOf(key, extensionTable.multiplier)] == key;
+    }
+
+}
+
+bool CamWatcher::isMediaFile(const std::string_view fileName) {
+    const auto dot = fileName.rfind('.');
+    if (dot == std::string_view::npos)
+        return false;
+    const auto ext = fileName.substr(dot + 1);
+    if (ext.empty() || ext.size() > maxExtensionLength || ext.find('/') != std::string_view::npos)
+        return false;
+    return isMediaExtensionKey(extensionKey(ext));
+}
+
+bool CamWatcher::isMediaFile(const QString& fileName) {
+    const int dot = fileName.lastIndexOf('.');
+    const int length = fileName.size() - dot - 1;
+    if (dot < 0 || length == 0 || length > maxExtensionLength)
+        return false;
+
+    char ext[maxExtensionLength];
+    for (int i = 0; i < length; i++) {
+        const auto c = fileName[dot + 1 + i].unicode();
+        if (c == '/' || c > 0x7f)
+            return false;
+        ext[i] = static_cast<char>(c);
+    }
+    return isMediaExtensionKey(extensionKey({ext, static_cast<size_t>(length)}));
+}
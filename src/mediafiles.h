@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QString>
+#include <string_view>
+
+namespace CamWatcher {
+
+    // Whether a file is a photo or video we should import, by extension (case insensitive)
+    bool isMediaFile(std::string_view fileName);
+    bool isMediaFile(const QString& fileName);
+
+}
@@ -0,0 +1,207 @@
+#include "metrics.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QSaveFile>
+#include <QSocketNotifier>
+#include <QtDebug>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace CamWatcher;
+
+namespace {
+    // The timeline keeps this many of the most recent stages
+    constexpr size_t maxTraceEvents = 200000;
+    // Written to by the signal handler, read on the main thread
+    int dumpSignalFds[2] = {-1, -1};
+
+    void onDumpSignal(int) {
+        const char c = 1;
+        [[maybe_unused]] const auto n = ::write(dumpSignalFds[1], &c, 1);
+    }
+
+    int threadNumber() {
+        static std::atomic<int> next = 1;
+        thread_local const int number = next++;
+        return number;
+    }
+
+    QByteArray escapeLabel(const QString& text) {
+        auto escaped = text.toUtf8();
+        escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+        return escaped;
+    }
+
+    QByteArray seconds(const quint64 us) {
+        return QByteArray::number(static_cast<double>(us) / 1e6, 'g', 6);
+    }
+}
+
+std::atomic<bool> Metrics::sEnabled = false;
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() : mDirPath(qEnvironmentVariable("CAMWATCHER_METRICS_DIR")), mEpoch(Clock::now()) {
+    if (mDirPath.isEmpty())
+        return;
+    QDir().mkpath(mDirPath);
+    sEnabled = true;
+    qInfo() << "Writing stage metrics to" << mDirPath;
+}
+
+void Metrics::record(const char* stage, const QString& device, const Clock::time_point start,
+                     const Clock::time_point end) {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    const auto startUs = duration_cast<microseconds>(start - mEpoch).count();
+    const auto durationUs = duration_cast<microseconds>(end - start).count();
+
+    std::lock_guard lock(mMutex);
+    mHistograms[{device, stage}].add(static_cast<quint64>(durationUs));
+    if (mTrace.size() == maxTraceEvents)
+        mTrace.pop_front();
+    mTrace.push_back({stage, device, startUs, durationUs, threadNumber()});
+}
+
+void Metrics::watchDumpSignal() {
+    if (!enabled() || dumpSignalFds[0] >= 0)
+        return;
+    if (::pipe2(dumpSignalFds, O_CLOEXEC | O_NONBLOCK) != 0) {
+        qWarning() << "Failed to watch for SIGUSR1, metrics are only written after imports";
+        return;
+    }
+
+    struct sigaction action {};
+    action.sa_handler = onDumpSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SIGUSR1, &action, nullptr);
+
+    const auto notifier = new QSocketNotifier(dumpSignalFds[0], QSocketNotifier::Read, qApp);
+    QObject::connect(notifier, &QSocketNotifier::activated, [this] {
+        char buffer[16];
+        while (::read(dumpSignalFds[0], buffer, sizeof(buffer)) > 0) {}
+        if (const auto err = dump(); !err.isEmpty())
+            qWarning() << err;
+    });
+}
+
+QString Metrics::dump() {
+    if (!enabled())
+        return {};
+
+    const QDir dir(mDirPath);
+    const QPair<QString, QByteArray> files[] = {
+            {dir.filePath("camerawatcher.prom"), prometheusText()},
+            {dir.filePath("camerawatcher-trace.json"), chromeTrace()},
+    };
+    for (const auto& [path, data]: files) {
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+            return QString("Failed to write %1: %2").arg(path, file.errorString());
+    }
+    return {};
+}
+
+QByteArray Metrics::prometheusText() const {
+    std::lock_guard lock(mMutex);
+
+    QByteArray out;
+    out += "# HELP camerawatcher_stage_seconds Time spent per stage of talking to a camera\n";
+    out += "# TYPE camerawatcher_stage_seconds histogram\n";
+    for (auto it = mHistograms.cbegin(); it != mHistograms.cend(); ++it) {
+        const auto labels = "device=\"" + escapeLabel(it.key().first) + "\",stage=\"" + escapeLabel(it.key().second) +
+                            '"';
+        const auto& histogram = it.value();
+
+        // Only the buckets that have something in them, the full set is close to a thousand
+        quint64 cumulative = 0;
+        for (int i = 0; i < Histogram::bucketCount; i++) {
+            if (!histogram.mBuckets[i])
+                continue;
+            cumulative += histogram.mBuckets[i];
+            out += "camerawatcher_stage_seconds_bucket{" + labels + ",le=\"" +
+                   seconds(Histogram::bucketEndUs(i)) + "\"} " + QByteArray::number(cumulative) + '\n';
+        }
+        out += "camerawatcher_stage_seconds_bucket{" + labels + ",le=\"+Inf\"} " +
+               QByteArray::number(histogram.count()) + '\n';
+        out += "camerawatcher_stage_seconds_sum{" + labels + "} " + seconds(histogram.sumUs()) + '\n';
+        out += "camerawatcher_stage_seconds_count{" + labels + "} " + QByteArray::number(histogram.count()) + '\n';
+    }
+
+    // Precomputed, for reading the file without a Prometheus server
+    out += "# HELP camerawatcher_stage_quantile_seconds Stage time quantiles, to within the bucket width\n";
+    out += "# TYPE camerawatcher_stage_quantile_seconds gauge\n";
+    for (auto it = mHistograms.cbegin(); it != mHistograms.cend(); ++it) {
+        const auto labels = "device=\"" + escapeLabel(it.key().first) + "\",stage=\"" + escapeLabel(it.key().second) +
+                            '"';
+        for (const auto q: {0.5, 0.9, 0.99}) {
+            out += "camerawatcher_stage_quantile_seconds{" + labels + ",quantile=\"" + QByteArray::number(q) + "\"} " +
+                   seconds(it.value().quantileUs(q)) + '\n';
+        }
+    }
+    return out;
+}
+
+QByteArray Metrics::chromeTrace() const {
+    std::lock_guard lock(mMutex);
+
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& event: mTrace) {
+        if (!first)
+            out += ",\n";
+        first = false;
+        // Complete events, one row per thread
+        out += "{\"name\":\"" + escapeLabel(event.stage) + "\",\"cat\":\"" + escapeLabel(event.device) +
+               "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(event.thread) +
+               ",\"ts\":" + QByteArray::number(event.startUs) + ",\"dur\":" + QByteArray::number(event.durationUs) +
+               ",\"args\":{\"device\":\"" + escapeLabel(event.device) + "\"}}";
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+void Metrics::Histogram::add(const quint64 us) {
+    int bucket = static_cast<int>(us);
+    if (us >= subBuckets) {
+        const int magnitude = 63 - __builtin_clzll(us);
+        const int shift = magnitude - 4;
+        bucket = subBuckets * (shift + 1) + static_cast<int>((us >> shift) & (subBuckets - 1));
+    }
+    mBuckets[bucket]++;
+    mCount++;
+    mSumUs += us;
+}
+
+quint64 Metrics::Histogram::count() const {
+    return mCount;
+}
+
+quint64 Metrics::Histogram::sumUs() const {
+    return mSumUs;
+}
+
+quint64 Metrics::Histogram::quantileUs(const double q) const {
+    const auto rank = static_cast<quint64>(q * static_cast<double>(mCount));
+    quint64 cumulative = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        cumulative += mBuckets[i];
+        if (mBuckets[i] && cumulative > rank)
+            return bucketEndUs(i);
+    }
+    return 0;
+}
+
+quint64 Metrics::Histogram::bucketEndUs(const int bucket) {
+    if (bucket < subBuckets)
+        return static_cast<quint64>(bucket) + 1;
+    const int shift = bucket / subBuckets - 1;
+    const auto sub = static_cast<quint64>(bucket % subBuckets);
+    return (subBuckets + sub + 1) << shift;
+}
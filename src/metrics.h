@@ -0,0 +1,112 @@
+#pragma once
+
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+namespace CamWatcher {
+
+    /**
+     * How long each stage of talking to cameras takes, per device: a latency histogram per stage, and the most
+     * recent stages as a timeline.
+     *
+     * Off unless CAMWATCHER_METRICS_DIR is set. Then the histograms go to camerawatcher.prom (Prometheus text
+     * format) and the timeline to camerawatcher-trace.json (Chrome trace, open in chrome://tracing or Perfetto) in
+     * that directory, after every import and on SIGUSR1.
+     */
+    class Metrics {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static Metrics& instance();
+
+        // Cheap enough to check on every stage
+        [[nodiscard]] static bool enabled() {
+            return sEnabled.load(std::memory_order_relaxed);
+        }
+
+        void record(const char* stage, const QString& device, Clock::time_point start, Clock::time_point end);
+        // Dump when the process gets SIGUSR1, call from the main thread once there is an event loop
+        void watchDumpSignal();
+        // Write both files, empty on success
+        QString dump();
+
+    private:
+        // Log-linear buckets over microseconds: exact below 16, then 16 per power of two (within ~6%)
+        class Histogram {
+        public:
+            static constexpr int subBuckets = 16;
+            static constexpr int bucketCount = subBuckets + 60 * subBuckets;
+
+            void add(quint64 us);
+            [[nodiscard]] quint64 count() const;
+            [[nodiscard]] quint64 sumUs() const;
+            // Upper bound of the bucket holding the value at q (0-1)
+            [[nodiscard]] quint64 quantileUs(double q) const;
+            // The first value past the bucket
+            [[nodiscard]] static quint64 bucketEndUs(int bucket);
+
+            std::array<quint64, bucketCount> mBuckets{};
+
+        private:
+            quint64 mCount = 0;
+            quint64 mSumUs = 0;
+        };
+
+        struct TraceEvent {
+            const char* stage;
+            QString device;
+            qint64 startUs;
+            qint64 durationUs;
+            int thread;
+        };
+
+        Metrics();
+
+        [[nodiscard]] QByteArray prometheusText() const;
+        [[nodiscard]] QByteArray chromeTrace() const;
+
+        static std::atomic<bool> sEnabled;
+        QString mDirPath;
+        const Clock::time_point mEpoch;
+        // Keyed by device, then stage
+        QMap<QPair<QString, QString>, Histogram> mHistograms;
+        std::deque<TraceEvent> mTrace;
+        mutable std::mutex mMutex;
+    };
+
+    /**
+     * Times the scope it lives in as a stage, eg:
+     *   StageTimer timer("list", dev.slug());
+     * Does nothing when metrics are off. The device name is referenced, not copied, it must outlive the timer.
+     */
+    class StageTimer {
+    public:
+        explicit StageTimer(const char* stage) : StageTimer(stage, nullptr) {}
+        StageTimer(const char* stage, const QString& device) : StageTimer(stage, &device) {}
+
+        ~StageTimer() {
+            if (mStart != Metrics::Clock::time_point())
+                Metrics::instance().record(mStage, mDevice ? *mDevice : QString(), mStart, Metrics::Clock::now());
+        }
+
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+
+    private:
+        StageTimer(const char* stage, const QString* device) : mStage(stage), mDevice(device) {
+            if (Metrics::enabled())
+                mStart = Metrics::Clock::now();
+        }
+
+        const char* mStage;
+        const QString* mDevice;
+        Metrics::Clock::time_point mStart;
+    };
+
+}
@@ -0,0 +1,277 @@
+#include "mockbackend.h"
+
+#include "utils.h"
+
+#include <QTimer>
+#include <QtDebug>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace CamWatcher;
+
+namespace {
+
+    constexpr qint64 mockChunkSize = 1 << 20;
+    constexpr int mockListBatchSize = 256;
+    constexpr int mockBus = 999;
+    constexpr int mockPort = 1;
+    constexpr qint64 mockTimestamp = 1600000000;
+    constexpr auto unpluggedError = "Could not find the requested device on the USB port";
+    constexpr auto cancelledError = "Cancelled";
+    constexpr auto cancelPollInterval = std::chrono::milliseconds(10);
+
+    int envInt(const char* name, const int defaultValue) {
+        bool ok = false;
+        const int value = qEnvironmentVariableIntValue(name, &ok);
+        return ok ? value : defaultValue;
+    }
+
+    // Saturation and value 0-255, like QColor::fromHsv()
+    std::array<char, 3> hsvToRgb(const int hue, const int saturation, const int value) {
+        const double s = saturation / 255.0;
+        const double v = value / 255.0;
+        const double c = v * s;
+        const double x = c * (1 - std::abs(std::fmod(hue / 60.0, 2) - 1));
+        const double m = v - c;
+        double r = 0, g = 0, b = 0;
+        switch (hue / 60) {
+            case 0: r = c, g = x; break;
+            case 1: r = x, g = c; break;
+            case 2: g = c, b = x; break;
+            case 3: g = x, b = c; break;
+            case 4: r = x, b = c; break;
+            default: r = c, b = x; break;
+        }
+        const auto byte = [m](const double channel) { return static_cast<char>(qRound((channel + m) * 255)); };
+        return {byte(r), byte(g), byte(b)};
+    }
+
+    // Waits like a slow camera would, but gives up as soon as it's cancelled
+    bool sleepUntil(const std::chrono::steady_clock::time_point until, const CancelToken& cancel) {
+        while (!cancel.isCancelled()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= until)
+                return true;
+            std::this_thread::sleep_until(qMin(until, now + cancelPollInterval));
+        }
+        return false;
+    }
+
+    // Reported like udev would, the card stays as it is
+    void setPlugged(const std::shared_ptr<MockBackend::Card>& card, const bool plugged) {
+        UsbEventSink sink;
+        {
+            std::lock_guard lock(card->mutex);
+            if (card->plugged == plugged)
+                return;
+            card->plugged = plugged;
+            card->filesRead = 0;
+            sink = card->eventSink;
+        }
+        qInfo() << "Mock camera" << (plugged ? "plugged in" : "unplugged");
+        if (sink)
+            sink({{plugged, mockBus, mockPort}});
+
+        if (!plugged && card->script.replugMs > 0) {
+            // Timers need an event loop, the main thread has one
+            invokeOnMainThread([card] {
+                QTimer::singleShot(card->script.replugMs, [card] { setPlugged(card, true); });
+            });
+        }
+    }
+
+    class MockSession final : public CameraSession {
+    public:
+        explicit MockSession(std::shared_ptr<MockBackend::Card> card) : mCard(std::move(card)) {}
+
+        QString listFiles(const FileBatchSink& sink) override {
+            QVector<UsbFile> files;
+            {
+                std::lock_guard lock(mCard->mutex);
+                if (!mCard->plugged)
+                    return unpluggedError;
+                files = mCard->files;
+            }
+            for (int i = 0; i < files.size(); i += mockListBatchSize)
+                sink(files.mid(i, mockListBatchSize));
+            return {};
+        }
+
+        QString readFile(const QString& cameraPath, const qint64 offset, const DataSink& sink,
+                         const CancelToken& cancel) override {
+            qint64 size = 0;
+            if (auto err = fileSize(cameraPath, size); !err.isEmpty())
+                return err;
+
+            if (auto err = startRead(cancel); !err.isEmpty())
+                return err;
+
+            const auto buffer = content(cameraPath);
+            const auto started = std::chrono::steady_clock::now();
+            for (qint64 pos = offset; pos < size;) {
+                const auto start = pos % mockChunkSize;
+                const auto length = qMin(mockChunkSize - start, size - pos);
+                if (!sink(buffer.data() + start, length))
+                    return "Transfer aborted";
+                pos += length;
+                if (!throttle(started, pos - offset, cancel))
+                    return cancelledError;
+            }
+            finishRead();
+            return {};
+        }
+
+        [[nodiscard]] bool supportsRangeReads() const override {
+            return true;
+        }
+
+        QString fileSize(const QString& cameraPath, qint64& bytes) override {
+            std::lock_guard lock(mCard->mutex);
+            if (!mCard->plugged)
+                return unpluggedError;
+            for (const auto& f: mCard->files) {
+                if (f.filePath() == cameraPath) {
+                    bytes = static_cast<qint64>(f.kbSize()) * 1024;
+                    return {};
+                }
+            }
+            return "No such file: " + cameraPath;
+        }
+
+        QString readRange(const QString& cameraPath, const qint64 offset, const qint64 length,
+                          QByteArray& data) override {
+            qint64 size = 0;
+            if (auto err = fileSize(cameraPath, size); !err.isEmpty())
+                return err;
+
+            const auto buffer = content(cameraPath);
+            data.clear();
+            for (qint64 i = offset; i < qMin(size, offset + length); i++) data.append(buffer[i % mockChunkSize]);
+            return {};
+        }
+
+        QString readThumbnail(const QString& cameraPath, QByteArray& data, const CancelToken& cancel) override {
+            if (cancel.isCancelled())
+                return cancelledError;
+            qint64 size = 0;
+            if (auto err = fileSize(cameraPath, size); !err.isEmpty())
+                return err;
+
+            // A flat color per file is enough to tell them apart. Written as a PPM so the backend doesn't need QtGui.
+            const auto color = hsvToRgb(static_cast<int>(qHash(cameraPath) % 360), 160, 200);
+            data = QByteArray("P6\n160 120\n255\n");
+            for (int i = 0; i < 160 * 120; i++) data.append(color.data(), 3);
+            return {};
+        }
+
+        QString deleteFile(const QString& cameraPath) override {
+            std::lock_guard lock(mCard->mutex);
+            if (!mCard->plugged)
+                return unpluggedError;
+            for (int i = 0; i < mCard->files.size(); i++) {
+                if (mCard->files[i].filePath() == cameraPath) {
+                    mCard->files.remove(i);
+                    return {};
+                }
+            }
+            return "No such file: " + cameraPath;
+        }
+
+    private:
+        // Fails when the script says so, otherwise waits for the first byte
+        QString startRead(const CancelToken& cancel) {
+            const auto& script = mCard->script;
+            {
+                std::lock_guard lock(mCard->mutex);
+                if (!mCard->plugged)
+                    return unpluggedError;
+                if (script.failEvery > 0 && ++mCard->readsStarted % script.failEvery == 0)
+                    return "I/O problem (mock)";
+            }
+            const auto firstByte = std::chrono::steady_clock::now() + std::chrono::milliseconds(script.latencyMs);
+            return sleepUntil(firstByte, cancel) ? QString() : cancelledError;
+        }
+
+        // Hold the read back to the scripted MB/s (10^6 bytes, like camera specs), false when cancelled meanwhile
+        bool throttle(const std::chrono::steady_clock::time_point started, const qint64 bytes,
+                      const CancelToken& cancel) const {
+            if (mCard->script.mbps <= 0)
+                return !cancel.isCancelled();
+            return sleepUntil(started + std::chrono::microseconds(bytes / mCard->script.mbps), cancel);
+        }
+
+        // The camera goes away once the scripted number of files is read
+        void finishRead() {
+            bool unplug;
+            {
+                std::lock_guard lock(mCard->mutex);
+                unplug = ++mCard->filesRead == mCard->script.unplugAfter;
+            }
+            if (unplug)
+                setPlugged(mCard, false);
+        }
+
+        // Deterministic content, derived from the path so every file differs. Repeats every chunk.
+        static std::vector<char> content(const QString& cameraPath) {
+            std::vector<char> buffer(mockChunkSize);
+            auto seed = static_cast<quint32>(qHash(cameraPath));
+            for (auto& c: buffer) {
+                seed = seed * 1664525u + 1013904223u;
+                c = static_cast<char>(seed >> 24);
+            }
+            return buffer;
+        }
+
+        std::shared_ptr<MockBackend::Card> mCard;
+    };
+
+}
+
+MockBackend::MockBackend() : mCard(std::make_shared<Card>()) {
+    auto& script = mCard->script;
+    script.latencyMs = envInt("CAMWATCHER_MOCK_LATENCY_MS", 0);
+    script.mbps = envInt("CAMWATCHER_MOCK_MBPS", 0);
+    script.failEvery = envInt("CAMWATCHER_MOCK_FAIL_EVERY", 0);
+    script.unplugAfter = envInt("CAMWATCHER_MOCK_UNPLUG_AFTER", 0);
+    script.replugMs = envInt("CAMWATCHER_MOCK_REPLUG_MS", 0);
+
+    const int fileCount = envInt("CAMWATCHER_MOCK_FILES", 2000);
+    const int kbSize = envInt("CAMWATCHER_MOCK_KB", 4096);
+    for (int i = 0; i < fileCount; i++) {
+        const auto folder = QString("/store_00010001/DCIM/%1MOCK").arg(100 + i / 9999);
+        const auto path = QString("%1/IMG_%2.JPG").arg(folder).arg(i % 9999 + 1, 4, 10, QChar('0'));
+        mCard->files.append({path, kbSize, mockTimestamp + i});
+    }
+}
+
+MockBackend::~MockBackend() {
+    // A replug timer may still hold on to the card
+    std::lock_guard lock(mCard->mutex);
+    mCard->eventSink = nullptr;
+}
+
+QString MockBackend::name() const {
+    return "mock";
+}
+
+QString MockBackend::detectCameras(QVector<DetectedCamera>& cameras) {
+    std::lock_guard lock(mCard->mutex);
+    if (mCard->plugged)
+        cameras.append({"Mock Camera", mockBus, mockPort});
+    return {};
+}
+
+std::shared_ptr<CameraSession> MockBackend::openSession(const QString& name, int bus, int port) {
+    Q_UNUSED(name)
+    Q_UNUSED(bus)
+    Q_UNUSED(port)
+    return std::make_shared<MockSession>(mCard);
+}
+
+void MockBackend::watchEvents(UsbEventSink sink) {
+    std::lock_guard lock(mCard->mutex);
+    mCard->eventSink = std::move(sink);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "camerabackend.h"
+
+#include <QStringList>
+#include <mutex>
+
+namespace CamWatcher {
+
+    /**
+     * A fake camera for benchmarking and development without hardware, scripted through the environment:
+     *   CAMWATCHER_MOCK_FILES        number of files on the card (default 2000)
+     *   CAMWATCHER_MOCK_KB           size of each file (default 4096)
+     *   CAMWATCHER_MOCK_LATENCY_MS   delay before the first byte of every file
+     *   CAMWATCHER_MOCK_MBPS         read throughput in MB/s, unlimited when 0
+     *   CAMWATCHER_MOCK_FAIL_EVERY   every Nth file read fails
+     *   CAMWATCHER_MOCK_UNPLUG_AFTER the camera is unplugged after reading this many files
+     *   CAMWATCHER_MOCK_REPLUG_MS    and plugged in again after this long, it stays away when 0
+     * Unplugging and plugging in are reported like udev events.
+     */
+    class MockBackend final : public CameraBackend {
+    public:
+        MockBackend();
+        ~MockBackend() override;
+
+        [[nodiscard]] QString name() const override;
+        QString detectCameras(QVector<DetectedCamera>& cameras) override;
+        std::shared_ptr<CameraSession> openSession(const QString& name, int bus, int port) override;
+        void watchEvents(UsbEventSink sink) override;
+
+        struct Script {
+            int latencyMs = 0;
+            int mbps = 0;
+            int failEvery = 0;
+            int unplugAfter = 0;
+            int replugMs = 0;
+        };
+
+        struct Card {
+            Script script;
+            std::mutex mutex;
+            QVector<UsbFile> files;
+            bool plugged = true;
+            // Since it was last plugged in
+            int filesRead = 0;
+            int readsStarted = 0;
+            UsbEventSink eventSink;
+        };
+
+    private:
+        std::shared_ptr<Card> mCard;
+    };
+
+}
@@ -0,0 +1,61 @@
+#include "procstats.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QtDebug>
+#include <unistd.h>
+
+using namespace CamWatcher;
+
+namespace {
+    // Field 22 of /proc/self/stat, counted from the first field after the command name
+    constexpr int startTimeField = 22 - 3;
+
+    QByteArray readProcFile(const char* path) {
+        // Sizes in /proc are 0, read until the end instead
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return {};
+        return file.readAll();
+    }
+
+    // A "Name:   1234 kB" line from /proc/self/status
+    qint64 statusKbs(const QByteArray& status, const QByteArray& name) {
+        for (const auto& line: status.split('\n')) {
+            if (line.startsWith(name + ':'))
+                return line.mid(name.size() + 1).trimmed().split(' ').value(0).toLongLong();
+        }
+        return -1;
+    }
+
+    qint64 msSinceStart() {
+        const auto stat = readProcFile("/proc/self/stat");
+        const auto uptime = readProcFile("/proc/uptime");
+        // The command name may hold spaces, fields are counted after it
+        const int nameEnd = stat.lastIndexOf(')');
+        if (nameEnd < 0 || uptime.isEmpty())
+            return -1;
+
+        const auto fields = stat.mid(nameEnd + 2).split(' ');
+        bool ok = false;
+        const auto startTicks = fields.value(startTimeField).toLongLong(&ok);
+        if (!ok)
+            return -1;
+
+        const double uptimeSeconds = uptime.split(' ').value(0).toDouble();
+        return static_cast<qint64>(uptimeSeconds * 1000) - startTicks * 1000 / ::sysconf(_SC_CLK_TCK);
+    }
+}
+
+ProcStats CamWatcher::procStats() {
+    const auto status = readProcFile("/proc/self/status");
+    return {msSinceStart(), statusKbs(status, "VmRSS"), statusKbs(status, "VmHWM")};
+}
+
+ProcStats CamWatcher::logProcStats(const char* when) {
+    const auto stats = procStats();
+    qInfo("%s: %lld ms since start, RSS %lld KiB (peak %lld KiB)", when, stats.msSinceStart, stats.rssKbs,
+          stats.peakRssKbs);
+    return stats;
+}
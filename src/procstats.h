@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace CamWatcher {
+
+    // What this process costs, from /proc. Fields are -1 when unknown.
+    struct ProcStats {
+        // Since the process was started by the kernel, so it includes loading libraries
+        qint64 msSinceStart = -1;
+        // Resident memory now and at its peak
+        qint64 rssKbs = -1;
+        qint64 peakRssKbs = -1;
+    };
+
+    ProcStats procStats();
+    // Log the stats as of when, and return them
+    ProcStats logProcStats(const char* when);
+
+}
@@ -1,15 +1,21 @@
 #ifndef SLUGIFY_HPP
 #define SLUGIFY_HPP
 
+#include <array>
+#include <cstddef>
 #include <string>
-#include <unordered_map>
-#include <regex>
-#include <algorithm>
+#include <string_view>
+#include <utility>
 
-// SLUGIFY
-std::string slugify(std::string input)
+namespace slugify_detail
 {
-	std::unordered_map<std::string, std::string> charMap {
+	struct SlugifyEntry
+	{
+		std::string_view from;
+		std::string_view to;
+	};
+
+	constexpr SlugifyEntry slugifyEntries[] = {
 		// latin
 		{"À", "A"}, {"Á", "A"}, {"Â", "A"}, {"Ã", "A"}, {"Ä", "A"}, {"Å", "A"}, {"Æ", "AE"}, {
 		"Ç", "C"}, {"È", "E"}, {"É", "E"}, {"Ê", "E"}, {"Ë", "E"}, {"Ì", "I"}, {"Í", "I"}, {
@@ -75,30 +81,145 @@ std::string slugify(std::string input)
 		{"<", "less"}, {">", "greater"}
 	};
 
-	// loop every character in charMap
-	for(auto kv : charMap)
+	constexpr std::size_t entryCount = sizeof(slugifyEntries) / sizeof(slugifyEntries[0]);
+
+	// a stray byte that isn't valid UTF-8, never in the table
+	constexpr char32_t invalidCodePoint = 0xfffd;
+
+	// code point of the UTF-8 sequence at the start of s, and its length in bytes
+	constexpr char32_t decodeUtf8(std::string_view s, std::size_t& length)
+	{
+		const auto b0 = static_cast<unsigned char>(s[0]);
+		length = 1;
+		if (b0 < 0x80)
+			return b0;
+
+		std::size_t size = 0;
+		char32_t codePoint = 0;
+		if ((b0 & 0xe0) == 0xc0) {
+			size = 2;
+			codePoint = b0 & 0x1f;
+		} else if ((b0 & 0xf0) == 0xe0) {
+			size = 3;
+			codePoint = b0 & 0x0f;
+		} else if ((b0 & 0xf8) == 0xf0) {
+			size = 4;
+			codePoint = b0 & 0x07;
+		} else {
+			return invalidCodePoint;
+		}
+		if (s.size() < size)
+			return invalidCodePoint;
+		for (std::size_t i = 1; i < size; i++) {
+			const auto b = static_cast<unsigned char>(s[i]);
+			if ((b & 0xc0) != 0x80)
+				return invalidCodePoint;
+			codePoint = (codePoint << 6) | (b & 0x3f);
+		}
+		length = size;
+		return codePoint;
+	}
+
+	struct Transliteration
+	{
+		char32_t codePoint = 0;
+		std::string_view to;
+	};
+
+	// the entries sorted by code point, built at compile time. duplicates keep the first entry, like the map did
+	constexpr auto buildTable()
+	{
+		std::array<Transliteration, entryCount> table{};
+		std::size_t size = 0;
+		for (std::size_t i = 0; i < entryCount; i++) {
+			std::size_t length = 0;
+			const Transliteration entry{decodeUtf8(slugifyEntries[i].from, length), slugifyEntries[i].to};
+
+			std::size_t pos = size;
+			while (pos > 0 && table[pos - 1].codePoint > entry.codePoint)
+				pos--;
+			if (pos > 0 && table[pos - 1].codePoint == entry.codePoint)
+				continue;
+			for (std::size_t j = size; j > pos; j--)
+				table[j] = table[j - 1];
+			table[pos] = entry;
+			size++;
+		}
+		return std::make_pair(table, size);
+	}
+
+	constexpr auto sortedTable = buildTable();
+
+	inline const Transliteration* findTransliteration(char32_t codePoint)
 	{
-		// check if key is in string
-		if(input.find(kv.first) != std::string::npos)
-		{
-			// replace key with value
-			input.replace(input.find(kv.first), kv.first.length(), kv.second);
+		std::size_t lo = 0;
+		std::size_t hi = sortedTable.second;
+		while (lo < hi) {
+			const auto mid = (lo + hi) / 2;
+			if (sortedTable.first[mid].codePoint < codePoint)
+				lo = mid + 1;
+			else
+				hi = mid;
 		}
+		return lo < sortedTable.second && sortedTable.first[lo].codePoint == codePoint ? &sortedTable.first[lo] : nullptr;
+	}
+
+	constexpr bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
 	}
 
-	std::regex e1("[^\\w\\s$*_+~.()\'\"-]");
-	input = std::regex_replace(input, e1, "");
+	// \w and the few symbols a slug may keep
+	constexpr bool isKept(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+		       std::string_view("_$*+~.()'\"").find(c) != std::string_view::npos;
+	}
+}
 
-	std::regex e2("^\\s+|\\s+$");
-	input = std::regex_replace(input, e2, "");
+// SLUGIFY
+// Transliterates, drops anything else outside ASCII word characters and a few symbols, trims whitespace and
+// collapses runs of dashes and whitespace into a single dash. One pass, no allocation besides the result.
+inline std::string slugify(std::string_view input)
+{
+	using namespace slugify_detail;
 
-	std::regex e3("[-\\s]+");
-	input = std::regex_replace(input, e3, "-");
+	std::string out;
+	out.reserve(input.size());
+	bool inRun = false;
+	bool runHasDash = false;
 
-	std::regex e4("#-$");
-	input = std::regex_replace(input, e4, "");
+	const auto put = [&](char c) {
+		if (c == '-' || isSpace(c)) {
+			inRun = true;
+			runHasDash |= c == '-';
+			return;
+		}
+		if (!isKept(c))
+			return;
+		// Whitespace at the start is trimmed, a dash there is kept
+		if (inRun && (!out.empty() || runHasDash))
+			out += '-';
+		inRun = false;
+		runHasDash = false;
+		out += c;
+	};
 
-	return input;
-};
+	for (std::size_t i = 0; i < input.size();) {
+		std::size_t length = 1;
+		const auto codePoint = decodeUtf8(input.substr(i), length);
+		if (const auto t = findTransliteration(codePoint)) {
+			for (const char c: t->to)
+				put(c);
+		} else if (codePoint < 0x80) {
+			put(static_cast<char>(codePoint));
+		}
+		i += length;
+	}
+	// Same at the end
+	if (inRun && runHasDash)
+		out += '-';
+	return out;
+}
 
 #endif
@@ -0,0 +1,91 @@
+#include "sysfs.h"
+
+#include <QDir>
+#include <QFile>
+#include <algorithm>
+#include <array>
+
+using namespace CamWatcher;
+
+namespace {
+    const QString sysfsUsbDevicesPath = "/sys/bus/usb/devices";
+
+    constexpr int stillImageClass = 0x06;
+    constexpr int vendorSpecificClass = 0xff;
+
+    // Camera makers, some of which expose PTP behind a vendor specific interface class.
+    // Sorted, it is binary searched.
+    constexpr std::array<quint16, 16> cameraVendorIds{
+            0x040a, // Kodak
+            0x04a9, // Canon
+            0x04b0, // Nikon
+            0x04cb, // Fujifilm
+            0x04da, // Panasonic
+            0x04e8, // Samsung
+            0x054c, // Sony
+            0x05ca, // Ricoh
+            0x07b4, // Olympus
+            0x07cf, // Casio
+            0x0a17, // Pentax
+            0x1003, // Sigma
+            0x1a98, // Leica
+            0x25fb, // Ricoh Imaging
+            0x2672, // GoPro
+            0x2717, // Xiaomi
+    };
+}
+
+QString SysfsUsbDevice::rootPort() const {
+    const auto dot = name.indexOf('.');
+    return dot < 0 ? name : name.left(dot);
+}
+
+QString SysfsUsbDevice::attribute(const QString& attr) const {
+    QFile file(path + '/' + attr);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+    return QString::fromUtf8(file.readAll()).trimmed();
+}
+
+quint16 SysfsUsbDevice::vendorId() const {
+    return attribute("idVendor").toUShort(nullptr, 16);
+}
+
+quint16 SysfsUsbDevice::productId() const {
+    return attribute("idProduct").toUShort(nullptr, 16);
+}
+
+QVector<int> SysfsUsbDevice::interfaceClasses() const {
+    QVector<int> classes;
+    const QDir dir(path);
+    for (const auto& intf: dir.entryList({name + ":*"}, QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QFile file(dir.filePath(intf) + "/bInterfaceClass");
+        if (file.open(QIODevice::ReadOnly))
+            classes.append(file.readAll().trimmed().toInt(nullptr, 16));
+    }
+    return classes;
+}
+
+bool SysfsUsbDevice::mayBeCamera() const {
+    const auto classes = interfaceClasses();
+    if (classes.contains(stillImageClass))
+        return true;
+    return classes.contains(vendorSpecificClass) &&
+           std::binary_search(cameraVendorIds.begin(), cameraVendorIds.end(), vendorId());
+}
+
+std::optional<SysfsUsbDevice> CamWatcher::findSysfsUsbDevice(const int busNum, const int devNum) {
+    const QDir dir(sysfsUsbDevicesPath);
+    // Interfaces ("1-1:1.0") and root hubs ("usb1") are not what we're after
+    for (const auto& name: dir.entryList({QString("%1-*").arg(busNum)}, QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (name.contains(':'))
+            continue;
+
+        SysfsUsbDevice dev{name, dir.filePath(name), busNum, 0};
+        if (dev.attribute("busnum").toInt() != busNum || dev.attribute("devnum").toInt() != devNum)
+            continue;
+        dev.devNum = devNum;
+        return dev;
+    }
+    return std::nullopt;
+}
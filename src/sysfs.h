@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <optional>
+
+namespace CamWatcher {
+
+    // A USB device as seen under /sys/bus/usb/devices
+    struct SysfsUsbDevice {
+        // Kernel name, eg: "1-1.4.2", bus 1, root port 1, then hub ports 4 and 2
+        QString name;
+        QString path;
+        int busNum;
+        int devNum;
+
+        // Bus and root hub port, eg: "1-1". Devices sharing it share the link to the host controller.
+        [[nodiscard]] QString rootPort() const;
+        [[nodiscard]] QString attribute(const QString& attr) const;
+        [[nodiscard]] quint16 vendorId() const;
+        [[nodiscard]] quint16 productId() const;
+        // bInterfaceClass of each interface of the active configuration
+        [[nodiscard]] QVector<int> interfaceClasses() const;
+        // Whether this could be something gphoto2 talks to, from sysfs alone without touching the device
+        [[nodiscard]] bool mayBeCamera() const;
+    };
+
+    // Look up a device by the bus and device number gphoto2 reports (usb:BBB,DDD)
+    std::optional<SysfsUsbDevice> findSysfsUsbDevice(int busNum, int devNum);
+
+}
@@ -0,0 +1,156 @@
+#include "thumbnailcache.h"
+
+#include "camerabackend.h"
+#include "usbdevice.h"
+#include "usbmanager.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QtDebug>
+#include <optional>
+
+using namespace CamWatcher;
+
+namespace {
+    // The camera is the bottleneck, more workers would only queue up on its session
+    constexpr int workerCount = 2;
+    constexpr int memoryBudgetKb = 32 * 1024;
+}
+
+ThumbnailCache::Shared::Shared(UsbDevice* device) : device(device), images(memoryBudgetKb) {}
+
+ThumbnailCache::ThumbnailCache(UsbDevice& device) : mShared(std::make_shared<Shared>(&device)) {
+    mShared->cache = this;
+}
+
+ThumbnailCache::~ThumbnailCache() {
+    releaseDevice();
+}
+
+QImage ThumbnailCache::thumbnail(const UsbFile& file) const {
+    std::lock_guard lock(mShared->mutex);
+    if (!mShared->device)
+        return {};
+    const auto image = mShared->images.object(cacheKey(mShared->device->identity(), file));
+    return image ? *image : QImage();
+}
+
+void ThumbnailCache::request(const QVector<UsbFile>& files) {
+    std::lock_guard lock(mShared->mutex);
+    if (!mShared->device)
+        return;
+    const auto& identity = mShared->device->identity();
+    mShared->queue.clear();
+    for (const auto& file: files) {
+        if (!mShared->images.contains(cacheKey(identity, file)) && !mShared->inFlight.contains(file.filePath()))
+            mShared->queue.push_back(file);
+    }
+
+    while (mShared->workers < workerCount && mShared->workers < static_cast<int>(mShared->queue.size())) {
+        mShared->workers++;
+        QThreadPool::globalInstance()->start([shared = mShared] { work(shared); });
+    }
+}
+
+void ThumbnailCache::releaseDevice() {
+    std::lock_guard lock(mShared->mutex);
+    mShared->device = nullptr;
+    mShared->cache = nullptr;
+    mShared->queue.clear();
+    mShared->cancel.cancel();
+}
+
+void ThumbnailCache::work(const std::shared_ptr<Shared>& shared) {
+    while (true) {
+        std::optional<UsbFile> file;
+        QString key;
+        {
+            std::lock_guard lock(shared->mutex);
+            if (shared->queue.empty() || !shared->device) {
+                shared->workers--;
+                return;
+            }
+            file = shared->queue.front();
+            shared->queue.pop_front();
+            shared->inFlight.insert(file->filePath());
+            key = cacheKey(shared->device->identity(), *file);
+        }
+
+        const auto image = load(shared, *file, key);
+
+        std::lock_guard lock(shared->mutex);
+        shared->inFlight.remove(file->filePath());
+        if (!image.isNull()) {
+            const int costKb = qMax(1, static_cast<int>(image.sizeInBytes() / 1024));
+            shared->images.insert(key, new QImage(image), costKb);
+        }
+        // Dropped if the cache is deleted before it gets there
+        if (const auto cache = shared->cache) {
+            const auto cameraPath = file->filePath();
+            QMetaObject::invokeMethod(cache, [cache, cameraPath] { cache->thumbnailReady(cameraPath); },
+                                      Qt::QueuedConnection);
+        }
+    }
+}
+
+QImage ThumbnailCache::load(const std::shared_ptr<Shared>& shared, const UsbFile& file, const QString& key) {
+    const auto diskPath = diskCachePath(key);
+
+    QByteArray data;
+    QFile cached(diskPath);
+    if (cached.open(QIODevice::ReadOnly)) {
+        data = cached.readAll();
+    } else {
+        std::shared_ptr<CameraSession> session;
+        std::shared_ptr<BusLane> lane;
+        {
+            // Quick, the camera itself isn't talked to until the read
+            std::lock_guard lock(shared->mutex);
+            if (!shared->device)
+                return {};
+            session = shared->device->session();
+            lane = shared->device->usbManager().busLane(shared->device->bus(), shared->device->port());
+        }
+        {
+            // Files being imported go first
+            BusLane::Slot slot(lane.get());
+            if (const auto err = session->readThumbnail(file.filePath(), data, shared->cancel); !err.isEmpty()) {
+                qDebug() << "No thumbnail for" << file.filePath() << err;
+                return {};
+            }
+        }
+
+        // Store what the camera gave us, it's already compressed
+        if (QDir().mkpath(QFileInfo(diskPath).path())) {
+            QSaveFile out(diskPath);
+            if (out.open(QIODevice::WriteOnly)) {
+                out.write(data);
+                out.commit();
+            }
+        }
+    }
+
+    auto image = QImage::fromData(data);
+    if (image.width() > maxThumbnailSize || image.height() > maxThumbnailSize)
+        image = image.scaled(maxThumbnailSize, maxThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    return image;
+}
+
+QString ThumbnailCache::cacheKey(const QString& identity, const UsbFile& file) {
+    // Same as a catalog entry, a changed file gets a new thumbnail
+    return QString("%1\n%2\n%3\n%4")
+            .arg(identity, file.filePath())
+            .arg(file.kbSize())
+            .arg(file.timestamp());
+}
+
+QString ThumbnailCache::diskCachePath(const QString& key) {
+    const auto dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails";
+    const auto hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return dir + '/' + hash.left(2) + '/' + hash + ".jpg";
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "canceltoken.h"
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSet>
+#include <QVector>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace CamWatcher {
+
+    class UsbDevice;
+    class UsbFile;
+
+    /**
+     * Previews of the files on a camera, from the thumbnail the camera embeds in each file.
+     * Fetched on request by a couple of workers, kept in a memory bounded LRU and cached on disk per catalog entry,
+     * so a camera plugged in again shows its previews without touching the device.
+     */
+    class ThumbnailCache final : public QObject {
+        Q_OBJECT
+    public:
+        static constexpr int maxThumbnailSize = 160;
+
+        explicit ThumbnailCache(UsbDevice& device);
+        // Doesn't wait for the workers, see releaseDevice()
+        ~ThumbnailCache() override;
+
+        // Null until thumbnailReady() was emitted for the file
+        [[nodiscard]] QImage thumbnail(const UsbFile& file) const;
+        /**
+         * Fetch thumbnails for these files, in this order (eg: the ones in view first, then the ones around them).
+         * Replaces what was requested before and hasn't started yet, so scrolling past files doesn't queue them up.
+         */
+        void request(const QVector<UsbFile>& files);
+        // Drop what's queued and cancel reads in progress. Workers still finishing up don't touch the device after
+        // this returns, which is right away.
+        void releaseDevice();
+
+    Q_SIGNALS:
+        // Emitted on the main thread, also when no thumbnail could be had so the caller can stop waiting
+        void thumbnailReady(const QString& cameraPath);
+
+    private:
+        // Everything the workers use, they may outlive the cache
+        struct Shared {
+            explicit Shared(UsbDevice* device);
+
+            // Both null once the device is released
+            UsbDevice* device;
+            ThumbnailCache* cache = nullptr;
+            CancelToken cancel;
+            std::deque<UsbFile> queue;
+            QSet<QString> inFlight;
+            int workers = 0;
+            // Cost in KiB
+            QCache<QString, QImage> images;
+            std::mutex mutex;
+        };
+
+        static void work(const std::shared_ptr<Shared>& shared);
+        static QImage load(const std::shared_ptr<Shared>& shared, const UsbFile& file, const QString& key);
+        [[nodiscard]] static QString cacheKey(const QString& identity, const UsbFile& file);
+        [[nodiscard]] static QString diskCachePath(const QString& key);
+
+        const std::shared_ptr<Shared> mShared;
+    };
+
+}
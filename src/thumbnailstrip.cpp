@@ -0,0 +1,135 @@
+#include "thumbnailstrip.h"
+
+#include <QScrollBar>
+
+using namespace CamWatcher;
+
+namespace {
+    constexpr int iconSize = 64;
+    // Fetched ahead of and behind the visible items, so scrolling a little doesn't show blanks
+    constexpr int lookAhead = 16;
+    constexpr int lookBehind = 4;
+}
+
+void ThumbnailModel::setFiles(const FileSnapshot& files) {
+    if (files == mFiles)
+        return;
+    beginResetModel();
+    mFiles = files;
+    mIcons.clear();
+    endResetModel();
+}
+
+const FileSnapshot& ThumbnailModel::files() const {
+    return mFiles;
+}
+
+bool ThumbnailModel::hasIcon(const int row) const {
+    return mIcons.contains(row);
+}
+
+void ThumbnailModel::setIcon(const int row, const QImage& image) {
+    mIcons.insert(row, QPixmap::fromImage(image));
+    dataChanged(index(row), index(row), {Qt::DecorationRole});
+}
+
+int ThumbnailModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : mFiles->size();
+}
+
+QVariant ThumbnailModel::data(const QModelIndex& index, const int role) const {
+    if (!index.isValid() || index.row() >= mFiles->size())
+        return {};
+    switch (role) {
+        case Qt::DecorationRole:
+            return mIcons.value(index.row());
+        case Qt::ToolTipRole:
+            return mFiles->fileName(index.row());
+        case Qt::SizeHintRole:
+            return QSize(iconSize + 4, iconSize + 4);
+        default:
+            return {};
+    }
+}
+
+ThumbnailStrip::ThumbnailStrip(UsbDevice& device) : mThumbnails(device) {
+    setObjectName("thumbnailStrip");
+    setModel(&mModel);
+    setViewMode(QListView::IconMode);
+    setFlow(QListView::LeftToRight);
+    setWrapping(false);
+    setMovement(QListView::Static);
+    setUniformItemSizes(true);
+    setSelectionMode(QAbstractItemView::NoSelection);
+    setIconSize({iconSize, iconSize});
+    setFixedHeight(iconSize + 2 * frameWidth() + horizontalScrollBar()->sizeHint().height() + 8);
+    setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+
+    // Scrolling fires a lot, only look at where it ends up
+    mRequestTimer.setSingleShot(true);
+    mRequestTimer.setInterval(50);
+    connect(&mRequestTimer, &QTimer::timeout, this, &ThumbnailStrip::requestVisible);
+    connect(horizontalScrollBar(), &QScrollBar::valueChanged, &mRequestTimer, qOverload<>(&QTimer::start));
+    connect(&mThumbnails, &ThumbnailCache::thumbnailReady, this, &ThumbnailStrip::onThumbnailReady);
+}
+
+void ThumbnailStrip::setFiles(const FileSnapshot& files) {
+    mModel.setFiles(files);
+    mRequestTimer.start();
+}
+
+void ThumbnailStrip::releaseDevice() {
+    mRequestTimer.stop();
+    mThumbnails.releaseDevice();
+}
+
+void ThumbnailStrip::resizeEvent(QResizeEvent* event) {
+    QListWidget::resizeEvent(event);
+    mRequestTimer.start();
+}
+
+void ThumbnailStrip::showEvent(QShowEvent* event) {
+    QListWidget::showEvent(event);
+    mRequestTimer.start();
+}
+
+void ThumbnailStrip::requestVisible() {
+    const auto& files = mModel.files();
+    if (files->isEmpty() || !isVisible())
+        return;
+
+    const auto viewRect = viewport()->rect();
+    const auto firstIndex = indexAt(viewRect.topLeft() + QPoint(1, 1));
+    const int first = firstIndex.isValid() ? firstIndex.row() : 0;
+    int last = first;
+    while (last + 1 < files->size() && visualRect(mModel.index(last + 1)).intersects(viewRect)) last++;
+
+    // What's in view first, then what's next to it
+    QVector<int> rows;
+    for (int i = first; i <= last; i++) rows.append(i);
+    for (int i = last + 1; i < qMin(files->size(), last + 1 + lookAhead); i++) rows.append(i);
+    for (int i = first - 1; i >= qMax(0, first - lookBehind); i--) rows.append(i);
+
+    QVector<UsbFile> wanted;
+    for (const int row: rows) {
+        if (mModel.hasIcon(row))
+            continue;
+        // Cached from earlier, no need to ask
+        const auto file = files->file(row);
+        if (const auto image = mThumbnails.thumbnail(file); !image.isNull())
+            mModel.setIcon(row, image);
+        else
+            wanted.append(file);
+    }
+    mThumbnails.request(wanted);
+}
+
+void ThumbnailStrip::onThumbnailReady(const QString& cameraPath) {
+    const auto& files = mModel.files();
+    const auto row = files->indexOf(cameraPath);
+    if (row < 0)
+        return;
+    const auto image = mThumbnails.thumbnail(files->file(row));
+    if (!image.isNull())
+        mModel.setIcon(row, image);
+}
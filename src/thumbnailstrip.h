@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QListView>
+#include <QPixmap>
+#include <QTimer>
+
+#include "thumbnailcache.h"
+#include "usbdevice.h"
+
+namespace CamWatcher {
+
+    // The files of a snapshot as rows, nothing is made for a file until its row is looked at
+    class ThumbnailModel final : public QAbstractListModel {
+    public:
+        // Nothing happens when it's the snapshot that is already there
+        void setFiles(const FileSnapshot& files);
+        [[nodiscard]] const FileSnapshot& files() const;
+        [[nodiscard]] bool hasIcon(int row) const;
+        void setIcon(int row, const QImage& image);
+
+        [[nodiscard]] int rowCount(const QModelIndex& parent = {}) const override;
+        [[nodiscard]] QVariant data(const QModelIndex& index, int role) const override;
+
+    private:
+        FileSnapshot mFiles = FileCatalog::empty();
+        QHash<int, QPixmap> mIcons;
+    };
+
+    // A scrollable row of previews, only fetching thumbnails for what is (nearly) in view
+    class ThumbnailStrip final : public QListView {
+        Q_OBJECT
+    public:
+        explicit ThumbnailStrip(UsbDevice& device);
+        void setFiles(const FileSnapshot& files);
+        // The device is about to go, stop fetching from it without waiting for reads in progress
+        void releaseDevice();
+
+    protected:
+        void resizeEvent(QResizeEvent* event) override;
+        void showEvent(QShowEvent* event) override;
+
+    private:
+        void requestVisible();
+        void onThumbnailReady(const QString& cameraPath);
+
+        ThumbnailCache mThumbnails;
+        ThumbnailModel mModel;
+        QTimer mRequestTimer;
+    };
+
+}
@@ -0,0 +1,103 @@
+#include "transferjournal.h"
+
+#include "hash64.h"
+
+#include <QtDebug>
+#include <unistd.h>
+
+using namespace CamWatcher;
+
+namespace {
+    const QString partialRecord = "part";
+    const QString doneRecord = "done";
+
+    QString journalFileName(const QString& cameraIdentity) {
+        const auto utf8 = cameraIdentity.toUtf8();
+        const auto hash = Hash64::hash(utf8.constData(), static_cast<size_t>(utf8.size()));
+        return QString(".camerawatcher-%1.journal").arg(hash, 16, 16, QChar('0'));
+    }
+}
+
+TransferJournal::TransferJournal(const QString& dirPath, const QString& cameraIdentity)
+    : mFile(dirPath + '/' + journalFileName(cameraIdentity)) {}
+
+bool TransferJournal::open() {
+    std::lock_guard lock(mMutex);
+
+    if (mFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        while (!mFile.atEnd()) {
+            const auto fields = QString::fromUtf8(mFile.readLine()).trimmed().split('\t');
+            // A torn last line from a crash is simply ignored
+            if (fields.size() == 7 && fields[0] == partialRecord) {
+                const FileKey key{fields[2].toInt(), fields[3].toLongLong()};
+                mPartials.insert(fields[1], {key, {fields[4], fields[5], fields[6].toLongLong()}});
+            } else if ((fields.size() == 5 || fields.size() == 6) && fields[0] == doneRecord) {
+                // Without a hash the line ends in the separator, which trimming took off
+                const FileKey key{fields[2].toInt(), fields[3].toLongLong()};
+                Done done{fields[4], std::nullopt};
+                bool ok = false;
+                if (const auto hash = fields.value(5).toULongLong(&ok, 16); ok)
+                    done.hash = hash;
+                mPartials.remove(fields[1]);
+                mDone.insert(fields[1], {key, done});
+            }
+        }
+        mFile.close();
+        if (!mPartials.isEmpty() || !mDone.isEmpty())
+            qInfo() << "Resuming import:" << mDone.size() << "files done," << mPartials.size() << "partial";
+    }
+
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "Failed to open journal" << mFile.fileName() << mFile.errorString();
+        return false;
+    }
+    return true;
+}
+
+std::optional<TransferJournal::Partial> TransferJournal::partial(const QString& cameraPath,
+                                                                 const FileKey& key) const {
+    std::lock_guard lock(mMutex);
+    const auto it = mPartials.constFind(cameraPath);
+    if (it == mPartials.constEnd() || !(it->first == key))
+        return std::nullopt;
+    return it->second;
+}
+
+std::optional<TransferJournal::Done> TransferJournal::done(const QString& cameraPath, const FileKey& key) const {
+    std::lock_guard lock(mMutex);
+    const auto it = mDone.constFind(cameraPath);
+    if (it == mDone.constEnd() || !(it->first == key))
+        return std::nullopt;
+    return it->second;
+}
+
+void TransferJournal::recordPartial(const QString& cameraPath, const FileKey& key, const Partial& partial) {
+    std::lock_guard lock(mMutex);
+    mPartials.insert(cameraPath, {key, partial});
+    append({partialRecord, cameraPath, QString::number(key.kbSize), QString::number(key.timestamp), partial.tempPath,
+            partial.outPath, QString::number(partial.committedBytes)});
+}
+
+void TransferJournal::recordDone(const QString& cameraPath, const FileKey& key, const Done& done) {
+    std::lock_guard lock(mMutex);
+    mPartials.remove(cameraPath);
+    mDone.insert(cameraPath, {key, done});
+    append({doneRecord, cameraPath, QString::number(key.kbSize), QString::number(key.timestamp), done.outPath,
+            done.hash ? QString::number(*done.hash, 16) : QString()});
+}
+
+void TransferJournal::remove() {
+    std::lock_guard lock(mMutex);
+    mFile.close();
+    mFile.remove();
+    mPartials.clear();
+    mDone.clear();
+}
+
+void TransferJournal::append(const QStringList& fields) {
+    if (!mFile.isOpen())
+        return;
+    mFile.write((fields.join('\t') + '\n').toUtf8());
+    mFile.flush();
+    ::fdatasync(mFile.handle());
+}
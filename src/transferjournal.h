@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <mutex>
+#include <optional>
+
+namespace CamWatcher {
+
+    /**
+     * Append-only log of an import into one directory, so an interrupted import picks up where it stopped.
+     * Records files that were fully written and verified, and for files in flight,
+     * how many bytes of their temp file are known to be on disk. Thread safe.
+     *
+     * There is one journal per camera in a directory, two bodies of the same model share the directory and their
+     * DCIM paths. Entries only count for the same version of a file, by its size and time on the camera.
+     */
+    class TransferJournal {
+    public:
+        struct Partial {
+            QString tempPath;
+            QString outPath;
+            qint64 committedBytes;
+        };
+
+        // The file on the camera an entry is about
+        struct Done {
+            QString outPath;
+            // Of the copy, checked against what came off the camera. Unknown when the read couldn't be hashed.
+            std::optional<quint64> hash;
+        };
+
+        struct FileKey {
+            int kbSize;
+            qint64 timestamp;
+
+            bool operator==(const FileKey& other) const {
+                return kbSize == other.kbSize && timestamp == other.timestamp;
+            }
+        };
+
+        TransferJournal(const QString& dirPath, const QString& cameraIdentity);
+
+        // Load what a previous run left behind and start appending
+        bool open();
+        [[nodiscard]] std::optional<Partial> partial(const QString& cameraPath, const FileKey& key) const;
+        // Where an earlier run wrote the file, if it was verified
+        [[nodiscard]] std::optional<Done> done(const QString& cameraPath, const FileKey& key) const;
+
+        void recordPartial(const QString& cameraPath, const FileKey& key, const Partial& partial);
+        void recordDone(const QString& cameraPath, const FileKey& key, const Done& done);
+        // Everything made it, the journal is no longer needed
+        void remove();
+
+    private:
+        void append(const QStringList& fields);
+
+        QFile mFile;
+        QHash<QString, QPair<FileKey, Partial>> mPartials;
+        QHash<QString, QPair<FileKey, Done>> mDone;
+        mutable std::mutex mMutex;
+    };
+
+}
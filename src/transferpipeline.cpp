@@ -0,0 +1,777 @@
+#include "transferpipeline.h"
+
+#include "diskwriter.h"
+#include "metrics.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QtDebug>
+#include <cerrno>
+#include <fcntl.h>
+#include <limits>
+#include <thread>
+#include <unistd.h>
+
+using namespace CamWatcher;
+
+namespace {
+    // Up to this many chunks (of up to a MiB each, depending on the backend) are buffered between camera and disk
+    constexpr size_t writeQueueCapacity = 32;
+    // Mirrors get more slack before they fall back to copying from the primary
+    constexpr size_t mirrorQueueCapacity = 256;
+    // Block size for mirrors copying from the primary
+    constexpr qint64 catchUpReadSize = 4 << 20;
+    constexpr size_t fileQueueCapacity = 256;
+    // Large files are synced and journaled every so often, a resume never has to go back further than this
+    constexpr qint64 commitInterval = 64 << 20;
+    // Completed files are synced and moved into place in batches of this many files or bytes, whichever comes first
+    constexpr int syncBatchFiles = 16;
+    constexpr qint64 syncBatchBytes = 256 << 20;
+    constexpr int maxReadAttempts = 3;
+    constexpr auto retryDelay = std::chrono::seconds(2);
+
+    constexpr int maxVerifyThreads = 4;
+    // Keeps gphoto2 command lines reasonable
+    constexpr int maxDeletesPerCall = 64;
+    constexpr qint64 verifyReadSize = 1 << 20;
+
+    // Read a written file back from disk, rather than from the page cache, and compare size and hash
+    QString checkFile(const QString& filePath, const qint64 size, const std::optional<quint64>& expectedHash,
+                      quint64& hash) {
+        const int fd = ::open(QFile::encodeName(filePath).constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return QString("File not copied:\n%1").arg(filePath);
+        // The data was synced when the file was moved into place, so the cached pages are clean and can go
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        Hash64 hasher;
+        QByteArray buffer(static_cast<int>(verifyReadSize), Qt::Uninitialized);
+        qint64 total = 0;
+        while (true) {
+            const auto n = ::read(fd, buffer.data(), static_cast<size_t>(buffer.size()));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0) {
+                ::close(fd);
+                return QString("Failed to read back %1").arg(filePath);
+            }
+            if (n == 0)
+                break;
+            hasher.update(buffer.constData(), static_cast<size_t>(n));
+            total += n;
+        }
+        ::close(fd);
+
+        hash = hasher.digest();
+        if (total != size)
+            return QString("File not copied completely:\n%1").arg(filePath);
+        if (expectedHash && *expectedHash != hash)
+            return QString("File corrupted on disk:\n%1").arg(filePath);
+        return {};
+    }
+
+    // Create the temp file for an output path, unless someone has it already. Imports of other cameras into the same
+    // directory, in this process or another, then see the name is taken. Only false when it exists.
+    bool claimTempFile(const QString& tempPath) {
+        const int fd = ::open(QFile::encodeName(tempPath).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return errno != EEXIST;
+        ::close(fd);
+        return true;
+    }
+
+    // Camera sizes are rounded to KB, allow for either rounding direction
+    bool sizeMatches(const qint64 bytes, const int kbSize) {
+        return qAbs(bytes / 1024 - kbSize) <= 1;
+    }
+
+    // Make renames in a directory durable
+    void syncDirectory(const QString& path) {
+        const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0)
+            return;
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+TransferPipeline::Destination::Destination(QString outDirPath, std::shared_ptr<DedupIndex> index,
+                                           const size_t queueCapacity)
+    : outDirPath(std::move(outDirPath)), dedupIndex(std::move(index)), writeQueue(queueCapacity) {}
+
+TransferPipeline::TransferPipeline(std::shared_ptr<CameraSession> session, QString outDirPath,
+                                   const bool removeOriginals)
+    : mSession(std::move(session)), mRemoveOriginals(removeOriginals), mVerifyQueue(fileQueueCapacity),
+      mDeleteQueue(fileQueueCapacity) {
+    mDestinations.push_back(std::make_unique<Destination>(std::move(outDirPath), nullptr, writeQueueCapacity));
+}
+
+void TransferPipeline::setProgressCallback(ProgressCallback callback) {
+    mProgressCallback = std::move(callback);
+}
+
+void TransferPipeline::setFileDoneCallback(FileDoneCallback callback) {
+    mFileDoneCallback = std::move(callback);
+}
+
+void TransferPipeline::setCancelToken(CancelToken token) {
+    mCancel = std::move(token);
+}
+
+void TransferPipeline::setBusLane(std::shared_ptr<BusLane> lane) {
+    mBusLane = std::move(lane);
+}
+
+void TransferPipeline::setDedupIndex(std::shared_ptr<DedupIndex> index) {
+    mDestinations.front()->dedupIndex = std::move(index);
+}
+
+void TransferPipeline::addMirror(QString outDirPath, std::shared_ptr<DedupIndex> index) {
+    mDestinations.push_back(std::make_unique<Destination>(std::move(outDirPath), std::move(index),
+                                                          mirrorQueueCapacity));
+}
+
+void TransferPipeline::setDeleteBatchSize(const int files) {
+    mDeleteBatchSize = files;
+}
+
+void TransferPipeline::setDeviceName(QString name) {
+    mDeviceName = std::move(name);
+}
+
+void TransferPipeline::setCameraIdentity(QString identity) {
+    mCameraIdentity = std::move(identity);
+}
+
+TransferPipeline::Result TransferPipeline::run(const FileSnapshot& files) {
+    mFiles = files;
+    const int fileCount = files->size();
+    mPendingDestinations = std::make_unique<std::atomic<int>[]>(fileCount);
+    for (int i = 0; i < fileCount; i++) mPendingDestinations[i] = static_cast<int>(mDestinations.size());
+    mUnverified = std::make_unique<std::atomic<bool>[]>(fileCount);
+    for (int i = 0; i < fileCount; i++) mUnverified[i] = false;
+    mSkippedEverywhere.fill(false, fileCount);
+    mPlaced.assign(fileCount, false);
+    mHashes.assign(fileCount, std::nullopt);
+
+    std::vector<std::thread> writers;
+    for (size_t d = 0; d < mDestinations.size(); d++) {
+        auto& dest = *mDestinations[d];
+        dest.outPaths.resize(fileCount);
+        dest.skipped.fill(false, fileCount);
+        dest.doneHashes.assign(fileCount, std::nullopt);
+        dest.result.outDirPath = dest.outDirPath;
+        dest.journal = std::make_unique<TransferJournal>(dest.outDirPath, mCameraIdentity);
+        dest.journal->open();
+        dest.manifest = std::make_unique<Manifest>(dest.outDirPath);
+        writers.emplace_back(&TransferPipeline::writeStage, this, static_cast<int>(d));
+    }
+    // Reading back is mostly waiting on the disk, a few in parallel keep it busy
+    std::vector<std::thread> verifiers;
+    const int verifierCount = qBound(1, QThread::idealThreadCount(), maxVerifyThreads);
+    mRunningVerifiers = verifierCount;
+    for (int i = 0; i < verifierCount; i++) verifiers.emplace_back(&TransferPipeline::verifyStage, this);
+    std::thread deleter(&TransferPipeline::deleteStage, this);
+
+    fetchStage();
+
+    for (auto& writer: writers) writer.join();
+    mVerifyQueue.close();
+    for (auto& verifier: verifiers) verifier.join();
+    deleter.join();
+    for (const auto& dest: mDestinations) dest->manifest->close();
+
+    std::lock_guard lock(mResultMutex);
+    for (const auto& dest: mDestinations) {
+        if (!mFailed && !dest->failed && dest->result.copiedFiles == fileCount)
+            dest->journal->remove();
+        mResult.destinations.append(dest->result);
+    }
+    mResult.transferredBytes = mTransferredBytes;
+    mResult.cancelled = mCancel.isCancelled();
+    return mResult;
+}
+
+void TransferPipeline::fetchStage() {
+    for (int i = 0; i < mFiles->size() && !failed() && !mCancel.isCancelled(); i++) {
+        BusLane::Slot slot(mBusLane.get());
+
+        // Read from the earliest point any destination still needs, the others get told they have it
+        const auto fingerprint = cameraFingerprint(i);
+        QVector<Destination*> targets;
+        qint64 offset = std::numeric_limits<qint64>::max();
+        for (const auto& dest: mDestinations) {
+            qint64 destOffset = 0;
+            if (!planFile(*dest, i, fingerprint, destOffset)) {
+                dest->skipped[i] = true;
+                continue;
+            }
+            targets.append(dest.get());
+            offset = qMin(offset, destOffset);
+        }
+
+        bool ok = true;
+        for (const auto& dest: mDestinations) {
+            if (dest->skipped[i])
+                ok = ok && send(*dest, {i, 0, {}, true, true});
+        }
+        if (!ok)
+            break;
+
+        if (targets.isEmpty()) {
+            mSkippedEverywhere[i] = true;
+            mSkippedBytes += static_cast<qint64>(mFiles->kbSize(i)) * 1024;
+            reportProgress();
+            continue;
+        }
+
+        mSkippedBytes += offset;
+        if (!fetchFile(i, offset, targets))
+            break;
+    }
+
+    // Cancelled: what's still queued is for files that won't be finished anyway
+    for (const auto& dest: mDestinations) {
+        if (mCancel.isCancelled())
+            dest->writeQueue.abort();
+        else
+            dest->writeQueue.close();
+    }
+}
+
+bool TransferPipeline::planFile(Destination& dest, const int fileIndex,
+                                const DedupIndex::CameraFingerprint& cameraFingerprint, qint64& offset) {
+    StageTimer timer("plan", mDeviceName);
+    const auto cameraPath = mFiles->filePath(fileIndex);
+
+    // Completed by an earlier run that was interrupted later on
+    const auto key = fileKey(fileIndex);
+    if (const auto done = dest.journal->done(cameraPath, key);
+        done && QFileInfo::exists(done->outPath) && sizeMatches(QFileInfo(done->outPath).size(), key.kbSize)) {
+        dest.outPaths[fileIndex] = done->outPath;
+        dest.doneHashes[fileIndex] = done->hash;
+        return false;
+    }
+
+    QString existingPath;
+    const auto match = dest.dedupIndex ? dest.dedupIndex->find(mFiles->fileName(fileIndex), mFiles->kbSize(fileIndex),
+                                                               cameraFingerprint, &existingPath)
+                                       : DedupIndex::Match::None;
+    // Name and size alone say little: counters get reset and other bodies of the same model use the same names, and
+    // fixed-size raws all look alike. Only a fingerprint match is skipped, the import catalog keeps us from copying
+    // the same card over and over.
+    if (match == DedupIndex::Match::Strong) {
+        dest.outPaths[fileIndex] = existingPath;
+        return false;
+    }
+
+    offset = 0;
+    const auto partial = dest.journal->partial(cameraPath, key);
+    if (partial && QFileInfo::exists(partial->tempPath) &&
+        QFileInfo(partial->tempPath).size() >= partial->committedBytes) {
+        qInfo() << "Resuming" << cameraPath << "at" << partial->committedBytes << "bytes";
+        offset = partial->committedBytes;
+        dest.outPaths[fileIndex] = partial->outPath;
+        dest.claimedPaths.insert(partial->outPath);
+    } else if (partial && QFileInfo::exists(partial->outPath) && claimTempFile(partial->tempPath)) {
+        // Moved into place by an earlier run but never verified, copied again over itself
+        dest.outPaths[fileIndex] = partial->outPath;
+        dest.claimedPaths.insert(partial->outPath);
+    } else {
+        dest.outPaths[fileIndex] = uniqueOutFilePath(dest, fileIndex);
+    }
+    return true;
+}
+
+bool TransferPipeline::fetchFile(const int fileIndex, qint64 offset, const QVector<Destination*>& targets) {
+    StageTimer timer("read", mDeviceName);
+    const auto cameraPath = mFiles->filePath(fileIndex);
+
+    // Every target gets the same buffers
+    const auto sendAll = [this, &targets](const Chunk& chunk) {
+        for (const auto dest: targets) {
+            if (!send(*dest, chunk))
+                return false;
+        }
+        return true;
+    };
+
+    // Hash while the data goes by, verifying compares what ends up on disk with it
+    Hash64 hasher;
+    const bool hashed = offset == 0 || hashPrefix(tempFilePath(*targets.front(), fileIndex), offset, hasher);
+
+    // A wiggly cable shouldn't end the import, retry from the last byte that made it into the queue
+    QString err;
+    for (int attempt = 1; attempt <= maxReadAttempts; attempt++) {
+        qint64 pos = offset;
+        err = mSession->readFile(cameraPath, offset, [&](const char* data, qint64 size) {
+            if (mCancel.isCancelled())
+                return false;
+            hasher.update(data, static_cast<size_t>(size));
+            const bool queued = sendAll({fileIndex, pos, QByteArray(data, static_cast<int>(size)), false});
+            pos += size;
+            mTransferredBytes += size;
+            reportProgress();
+            return queued;
+        }, mCancel);
+
+        if (err.isEmpty()) {
+            if (hashed)
+                mHashes[fileIndex] = hasher.digest();
+            return sendAll({fileIndex, pos, {}, true});
+        }
+        if (failed() || mCancel.isCancelled())
+            return false;
+
+        qWarning() << "Read of" << cameraPath << "failed at" << pos << "bytes, attempt" << attempt << ":" << err;
+        offset = pos;
+        std::this_thread::sleep_for(retryDelay);
+    }
+
+    fail(err, true);
+    return false;
+}
+
+bool TransferPipeline::send(Destination& dest, Chunk chunk) {
+    if (&dest == mDestinations.front().get())
+        return dest.writeQueue.push(std::move(chunk));
+
+    if (dest.failed || dest.catchUpFrom >= 0)
+        return true;
+    // Don't wait for a slow mirror, it copies this file and the ones after it from the primary later on
+    const int fileIndex = chunk.fileIndex;
+    if (!dest.writeQueue.tryPush(std::move(chunk)) && !dest.failed) {
+        qInfo() << "Mirror" << dest.outDirPath << "fell behind, copying from the primary from"
+                 << mFiles->filePath(fileIndex);
+        dest.catchUpFrom = fileIndex;
+        dest.writeQueue.close();
+    }
+    return true;
+}
+
+void TransferPipeline::writeStage(const int destination) {
+    auto& dest = *mDestinations[destination];
+    const bool primary = destination == 0;
+    DiskWriter writer;
+    int currentIndex = -1;
+    qint64 committed = 0;
+
+    // Written and closed, waiting for their data to be synced so they can be moved into place
+    struct PendingFile {
+        int fileIndex;
+        qint64 bytes;
+    };
+    QVector<PendingFile> pending;
+    qint64 pendingBytes = 0;
+
+    // Make everything written so far durable, and remember how far we got
+    const auto commit = [&] {
+        if (const auto err = writer.sync(); !err.isEmpty()) {
+            failDestination(dest, err);
+            return false;
+        }
+        committed = writer.pos();
+        dest.journal->recordPartial(mFiles->filePath(currentIndex), fileKey(currentIndex),
+                                    {writer.fileName(), dest.outPaths[currentIndex], committed});
+        return true;
+    };
+
+    // One round of syncs for the whole batch, then move the files into place
+    const auto finishPending = [&] {
+        if (pending.isEmpty())
+            return true;
+        StageTimer timer("sync", mDeviceName);
+        if (const auto err = writer.syncClosed(); !err.isEmpty()) {
+            failDestination(dest, err);
+            return false;
+        }
+
+        bool ok = true;
+        for (const auto& file: pending) {
+            const auto& outPath = dest.outPaths[file.fileIndex];
+            if (QFileInfo::exists(outPath))
+                QFile::remove(outPath);
+            if (!QFile::rename(tempFilePath(dest, file.fileIndex), outPath)) {
+                failDestination(dest, QString("Failed to move %1 into place").arg(tempFilePath(dest, file.fileIndex)));
+                ok = false;
+                break;
+            }
+        }
+        syncDirectory(dest.outDirPath);
+
+        // Not done for the journal yet, that waits for verifying
+        for (const auto& file: pending) {
+            if (!ok)
+                break;
+            if (primary)
+                placed(file.fileIndex);
+            ok = mVerifyQueue.push({destination, file.fileIndex, file.bytes});
+        }
+        pending.clear();
+        pendingBytes = 0;
+        return ok;
+    };
+
+    const auto fileWritten = [&](const qint64 bytes) {
+        if (const auto err = writer.close(); !err.isEmpty()) {
+            failDestination(dest, err);
+            return false;
+        }
+        pending.append({currentIndex, bytes});
+        pendingBytes += bytes;
+        currentIndex = -1;
+        return (pending.size() < syncBatchFiles && pendingBytes < syncBatchBytes) || finishPending();
+    };
+
+    while (auto chunk = dest.writeQueue.pop()) {
+        if (chunk->skipped) {
+            if (primary)
+                placed(chunk->fileIndex);
+            if (!mVerifyQueue.push({destination, chunk->fileIndex, 0, true}))
+                break;
+            continue;
+        }
+
+        if (chunk->fileIndex != currentIndex) {
+            currentIndex = chunk->fileIndex;
+            committed = chunk->offset;
+            const auto expectedSize = static_cast<qint64>(mFiles->kbSize(currentIndex)) * 1024;
+            if (const auto err = writer.open(tempFilePath(dest, currentIndex), chunk->offset, expectedSize);
+                !err.isEmpty()) {
+                failDestination(dest, err);
+                break;
+            }
+        }
+
+        // Re-reading after an error: drop anything past where this chunk goes
+        if (chunk->offset != writer.pos()) {
+            if (const auto err = writer.seek(chunk->offset); !err.isEmpty()) {
+                failDestination(dest, err);
+                break;
+            }
+        }
+
+        if (!chunk->data.isEmpty()) {
+            if (const auto err = writer.write(chunk->data); !err.isEmpty()) {
+                failDestination(dest, err);
+                break;
+            }
+            if (writer.pos() - committed >= commitInterval && !commit())
+                break;
+        }
+
+        if (chunk->last && !fileWritten(writer.pos()))
+            break;
+    }
+
+    // Cancelled halfway through a file, nobody asked to resume it. The journal entry is ignored without its temp file.
+    const auto discardPartial = [&] {
+        if (!writer.isOpen() || !mCancel.isCancelled())
+            return;
+        if (const auto err = writer.discard(); !err.isEmpty())
+            qWarning() << err;
+        currentIndex = -1;
+    };
+
+    // Interrupted halfway through a file (or a mirror fell behind), keep what we have for next time
+    discardPartial();
+    if (writer.isOpen() && currentIndex >= 0 && commit())
+        writer.close();
+
+    // A mirror that fell behind copies the rest from the primary, once the primary has each file in place
+    if (dest.catchUpFrom >= 0) {
+        for (int i = dest.catchUpFrom; i < mFiles->size() && !dest.failed && !failed() && !mCancel.isCancelled();
+             i++) {
+            if (!waitForPrimary(i))
+                break;
+            if (dest.skipped[i]) {
+                if (!mVerifyQueue.push({destination, i, 0, true}))
+                    break;
+                continue;
+            }
+
+            QFile source(mDestinations.front()->outPaths[i]);
+            if (!source.open(QIODevice::ReadOnly)) {
+                failDestination(dest, QString("Failed to open %1: %2").arg(source.fileName(), source.errorString()));
+                break;
+            }
+            currentIndex = i;
+            if (const auto err = writer.open(tempFilePath(dest, i), 0, source.size()); !err.isEmpty()) {
+                failDestination(dest, err);
+                break;
+            }
+            bool ok = true;
+            while (ok && !source.atEnd() && !mCancel.isCancelled()) {
+                const auto data = source.read(catchUpReadSize);
+                if (data.isEmpty()) {
+                    failDestination(dest, QString("Failed to read %1: %2").arg(source.fileName(), source.errorString()));
+                    ok = false;
+                } else if (const auto err = writer.write(data); !err.isEmpty()) {
+                    failDestination(dest, err);
+                    ok = false;
+                }
+            }
+            if (!ok || mCancel.isCancelled() || !fileWritten(writer.pos()))
+                break;
+        }
+        discardPartial();
+    }
+
+    // Files that completed still go into place, even when something else went wrong
+    finishPending();
+    if (primary) {
+        std::lock_guard lock(mPlacedMutex);
+        mPrimaryFinished = true;
+        mPlacedChanged.notify_all();
+    }
+}
+
+void TransferPipeline::verifyStage() {
+    while (auto file = mVerifyQueue.pop()) {
+        auto& dest = *mDestinations[file->destination];
+        if (!file->skipped) {
+            StageTimer timer("verify", mDeviceName);
+            const auto& outPath = dest.outPaths[file->fileIndex];
+            quint64 hash = 0;
+            if (const auto err = checkFile(outPath, file->bytes, mHashes[file->fileIndex], hash); !err.isEmpty()) {
+                failDestination(dest, err);
+                continue;
+            }
+            // Only a hash that was compared with the camera's says the copy is good
+            const auto verifiedHash = mHashes[file->fileIndex] ? std::optional<quint64>(hash) : std::nullopt;
+            dest.journal->recordDone(mFiles->filePath(file->fileIndex), fileKey(file->fileIndex),
+                                     {outPath, verifiedHash});
+            if (const auto err = dest.manifest->add(outPath, hash); !err.isEmpty())
+                qWarning() << err;
+            if (dest.dedupIndex)
+                dest.dedupIndex->add(outPath, file->bytes);
+        } else if (mRemoveOriginals && !mUnverified[file->fileIndex]) {
+            // Already there, the original only goes when the copy still is what was verified back then
+            StageTimer timer("verify", mDeviceName);
+            const auto& outPath = dest.outPaths[file->fileIndex];
+            const auto& expectedHash = dest.doneHashes[file->fileIndex];
+            quint64 hash = 0;
+            if (!expectedHash || !checkFile(outPath, QFileInfo(outPath).size(), expectedHash, hash).isEmpty()) {
+                if (expectedHash)
+                    qWarning() << "Keeping" << mFiles->filePath(file->fileIndex) << "on the camera," << outPath
+                               << "changed since it was copied";
+                mUnverified[file->fileIndex] = true;
+            }
+        }
+        {
+            std::lock_guard lock(mResultMutex);
+            dest.result.copiedFiles++;
+        }
+        // Imported once the primary has it, a failing mirror doesn't take that back
+        if (file->destination == 0)
+            fileDone(file->fileIndex);
+
+        // The original goes once every destination has it
+        if (--mPendingDestinations[file->fileIndex] > 0)
+            continue;
+        if (mRemoveOriginals && !mUnverified[file->fileIndex] && !mDeleteQueue.push(file->fileIndex))
+            break;
+    }
+    // The last one out
+    if (--mRunningVerifiers == 0)
+        mDeleteQueue.close();
+}
+
+void TransferPipeline::deleteStage() {
+    // Verified, waiting for their batch
+    QVector<int> batch;
+
+    const auto deleteBatch = [this, &batch] {
+        BusLane::Slot slot(mBusLane.get());
+        StageTimer timer("delete", mDeviceName);
+
+        // One call per folder, in listing order
+        QStringList folders;
+        QHash<QString, QVector<int>> byFolder;
+        for (const int fileIndex: batch) {
+            const auto folder = mFiles->folder(fileIndex);
+            auto& indices = byFolder[folder];
+            if (indices.isEmpty())
+                folders << folder;
+            indices.append(fileIndex);
+        }
+        batch.clear();
+
+        for (const auto& folder: folders) {
+            const auto& indices = byFolder[folder];
+            for (int start = 0; start < indices.size(); start += maxDeletesPerCall) {
+                const int count = qMin(maxDeletesPerCall, indices.size() - start);
+                QStringList fileNames;
+                for (int i = start; i < start + count; i++) fileNames << mFiles->fileName(indices[i]);
+
+                int deleted = 0;
+                const auto err = mSession->deleteFiles(folder, fileNames, deleted);
+                for (int i = start; i < start + deleted; i++) fileRemoved(indices[i]);
+                if (!err.isEmpty()) {
+                    fail(err);
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    while (auto fileIndex = mDeleteQueue.pop()) {
+        batch.append(*fileIndex);
+        if (mDeleteBatchSize > 0 && batch.size() >= mDeleteBatchSize && !deleteBatch()) {
+            mDeleteQueue.abort();
+            return;
+        }
+    }
+    // Whatever got verified, also when the import stopped early
+    if (!batch.isEmpty())
+        deleteBatch();
+}
+
+void TransferPipeline::fileDone(const int fileIndex) {
+    {
+        std::lock_guard lock(mResultMutex);
+        mResult.copiedFiles++;
+        mResult.copiedKbs += mFiles->kbSize(fileIndex);
+        if (mDestinations.front()->skipped[fileIndex])
+            mResult.skippedFiles++;
+    }
+    if (mFileDoneCallback)
+        mFileDoneCallback(mFiles->filePath(fileIndex), false);
+    reportProgress();
+}
+
+void TransferPipeline::fileRemoved(const int fileIndex) {
+    {
+        std::lock_guard lock(mResultMutex);
+        mResult.removedFiles++;
+    }
+    if (mFileDoneCallback)
+        mFileDoneCallback(mFiles->filePath(fileIndex), true);
+}
+
+void TransferPipeline::reportProgress() {
+    if (!mProgressCallback)
+        return;
+
+    int copiedFiles;
+    {
+        std::lock_guard lock(mResultMutex);
+        copiedFiles = mResult.copiedFiles;
+    }
+    mProgressCallback(copiedFiles, mTransferredBytes, mSkippedBytes);
+}
+
+bool TransferPipeline::hashPrefix(const QString& filePath, qint64 size, Hash64& hasher) {
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    while (size > 0) {
+        const auto data = file.read(qMin(size, verifyReadSize));
+        if (data.isEmpty())
+            return false;
+        hasher.update(data.constData(), static_cast<size_t>(data.size()));
+        size -= data.size();
+    }
+    return true;
+}
+
+void TransferPipeline::placed(const int fileIndex) {
+    std::lock_guard lock(mPlacedMutex);
+    mPlaced[fileIndex] = true;
+    mPlacedChanged.notify_all();
+}
+
+bool TransferPipeline::waitForPrimary(const int fileIndex) {
+    std::unique_lock lock(mPlacedMutex);
+    mPlacedChanged.wait(lock, [this, fileIndex] { return mPlaced[fileIndex] || mPrimaryFinished || failed(); });
+    return mPlaced[fileIndex];
+}
+
+void TransferPipeline::failDestination(Destination& dest, const QString& error) {
+    if (&dest == mDestinations.front().get()) {
+        fail(error);
+        return;
+    }
+
+    qWarning() << "Mirror" << dest.outDirPath << "failed:" << error;
+    {
+        std::lock_guard lock(mResultMutex);
+        if (dest.failed)
+            return;
+        dest.result.error = error;
+        dest.failed = true;
+    }
+    dest.writeQueue.abort();
+}
+
+void TransferPipeline::fail(const QString& error, const bool readError) {
+    {
+        std::lock_guard lock(mResultMutex);
+        if (mFailed)
+            return;
+        mResult.error = error;
+        mResult.readError = readError;
+        mFailed = true;
+    }
+    for (const auto& dest: mDestinations) dest->writeQueue.abort();
+    // Files already verified everywhere still get deleted, the delete stage drains its queue
+    mVerifyQueue.abort();
+    {
+        std::lock_guard lock(mPlacedMutex);
+        mPlacedChanged.notify_all();
+    }
+}
+
+bool TransferPipeline::failed() const {
+    return mFailed;
+}
+
+DedupIndex::CameraFingerprint TransferPipeline::cameraFingerprint(const int fileIndex) {
+    if (!mSession->supportsRangeReads())
+        return {};
+
+    // Read at most once per file, however many destinations ask
+    const auto cameraPath = mFiles->filePath(fileIndex);
+    auto cached = std::make_shared<std::optional<std::optional<QPair<qint64, quint64>>>>();
+    return [this, cameraPath, cached]() -> std::optional<QPair<qint64, quint64>> {
+        if (*cached)
+            return **cached;
+
+        *cached = std::optional<QPair<qint64, quint64>>();
+        qint64 size = 0;
+        if (!mSession->fileSize(cameraPath, size).isEmpty())
+            return std::nullopt;
+
+        const auto length = qMin(size, DedupIndex::fingerprintBytes);
+        QByteArray head;
+        QByteArray tail;
+        if (!mSession->readRange(cameraPath, 0, length, head).isEmpty() ||
+            !mSession->readRange(cameraPath, size - length, length, tail).isEmpty())
+            return std::nullopt;
+        **cached = qMakePair(size, DedupIndex::fingerprint(head, tail, size));
+        return **cached;
+    };
+}
+
+QString TransferPipeline::uniqueOutFilePath(Destination& dest, const int fileIndex) {
+    const QFileInfo info(mFiles->fileName(fileIndex));
+    auto path = dest.outDirPath + '/' + info.fileName();
+    for (int i = 1; dest.claimedPaths.contains(path) || QFileInfo::exists(path) || !claimTempFile(path + ".part");
+         i++) {
+        const auto suffix = info.suffix().isEmpty() ? QString() : '.' + info.suffix();
+        path = QString("%1/%2_%3%4").arg(dest.outDirPath, info.completeBaseName()).arg(i).arg(suffix);
+    }
+    dest.claimedPaths.insert(path);
+    return path;
+}
+
+TransferJournal::FileKey TransferPipeline::fileKey(const int fileIndex) const {
+    return {mFiles->kbSize(fileIndex), mFiles->timestamp(fileIndex)};
+}
+
+QString TransferPipeline::tempFilePath(const Destination& dest, const int fileIndex) {
+    return dest.outPaths[fileIndex] + ".part";
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "boundedqueue.h"
+#include "camerabackend.h"
+#include "canceltoken.h"
+#include "dedupindex.h"
+#include "filecatalog.h"
+#include "hash64.h"
+#include "manifest.h"
+#include "transferjournal.h"
+#include "transferscheduler.h"
+
+#include <QByteArray>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace CamWatcher {
+
+    /**
+     * Moves files off a camera with every stage running on its own thread:
+     *
+     *   fetch (camera) -> write (disk, one per destination) -> verify (a few threads) -> delete (camera, when moving)
+     *
+     * Stages are connected by bounded queues, so the camera keeps streaming while the disk is flushing
+     * and memory use stays capped when one side is slower than the other.
+     *
+     * Every file is read from the camera once and handed to each destination's writer, sharing the buffers.
+     * A mirror destination that can't keep up doesn't hold back the primary: it stops taking data from the camera
+     * and copies the remaining files from the primary's copies instead. A file is done once it's on the primary, but
+     * only deleted from the camera when moving once it's on every destination: a failed mirror keeps the originals of
+     * the files it's missing on the camera.
+     *
+     * Files are hashed as they come off the camera. Verifying reads every written file back from disk and checks
+     * its size and hash, and records the hash in a manifest in the destination directory.
+     *
+     * When moving, originals are deleted in batches once verified, grouped by folder, so deletes don't interleave
+     * with reads on the camera. By default that's once the whole set is through, see setDeleteBatchSize().
+     * A file that isn't copied because it's already there is only deleted when that copy can be verified too: one
+     * an earlier run journaled with its hash is read back and checked against it, a dedup match stays on the camera.
+     *
+     * Files are written to a temp file that is synced and renamed into place once complete, a batch of files at
+     * a time to keep flushes off the critical path. A journal per camera in the output directory tracks verified
+     * files and the synced part of unfinished ones, so running the same import again after an unplug or crash skips
+     * the verified files and resumes partial ones mid-file.
+     */
+    class TransferPipeline {
+    public:
+        struct DestinationResult {
+            QString outDirPath;
+            // Files that are on this destination, copied now or already there
+            int copiedFiles = 0;
+            QString error;
+        };
+
+        struct Result {
+            // Files that made it to the primary, see destinations for the mirrors
+            int copiedFiles = 0;
+            int copiedKbs = 0;
+            // Already at the primary, not transferred to it again (included in copiedFiles)
+            int skippedFiles = 0;
+            // Read from the camera in this run
+            qint64 transferredBytes = 0;
+            // Deleted from the camera, when moving
+            int removedFiles = 0;
+            QString error;
+            // The error came from reading the camera, as opposed to writing or verifying
+            bool readError = false;
+            // Stopped early through the cancel token
+            bool cancelled = false;
+            // The primary first, then the mirrors
+            QVector<DestinationResult> destinations;
+        };
+
+        // Called from pipeline threads for every chunk read and every file done. Bytes that didn't cross USB in
+        // this run (skipped files, the part of a resumed file that was already there) are counted as skipped.
+        using ProgressCallback = std::function<void(int copiedFiles, qint64 transferredBytes, qint64 skippedBytes)>;
+        // Called from a pipeline thread once a file is safely on the primary, and again when moving, once the
+        // original is deleted from the camera
+        using FileDoneCallback = std::function<void(const QString& cameraPath, bool removed)>;
+
+        TransferPipeline(std::shared_ptr<CameraSession> session, QString outDirPath, bool removeOriginals);
+
+        void setProgressCallback(ProgressCallback callback);
+        void setFileDoneCallback(FileDoneCallback callback);
+        // Cancelling stops the import mid-file: the read is abandoned and the partly written file removed. Files that
+        // are already complete still go into place.
+        void setCancelToken(CancelToken token);
+        // Camera access is done while holding a slot on this lane, one file at a time
+        void setBusLane(std::shared_ptr<BusLane> lane);
+        // Skip files already present at the destination, and register every file that lands
+        void setDedupIndex(std::shared_ptr<DedupIndex> index);
+        // Also put every file in outDirPath. When a mirror fails the import carries on without it.
+        void addMirror(QString outDirPath, std::shared_ptr<DedupIndex> index);
+        // When moving, delete originals as soon as this many are verified instead of after the whole set
+        void setDeleteBatchSize(int files);
+        // The device as named in stage metrics
+        void setDeviceName(QString name);
+        // Stays the same for the camera (eg: its serial), resuming only trusts what this camera left behind
+        void setCameraIdentity(QString identity);
+
+        // Transfer all files, blocks until every stage has finished
+        Result run(const FileSnapshot& files);
+
+    private:
+        struct Chunk {
+            int fileIndex;
+            // Where data goes in the file
+            qint64 offset;
+            QByteArray data;
+            bool last;
+            bool skipped = false;
+        };
+
+        struct WrittenFile {
+            int destination;
+            int fileIndex;
+            qint64 bytes;
+            bool skipped = false;
+        };
+
+        struct Destination {
+            Destination(QString outDirPath, std::shared_ptr<DedupIndex> index, size_t queueCapacity);
+
+            const QString outDirPath;
+            std::shared_ptr<DedupIndex> dedupIndex;
+            std::unique_ptr<TransferJournal> journal;
+            // Decided by the fetch stage before the first chunk of a file is queued
+            QVector<QString> outPaths;
+            QVector<bool> skipped;
+            // Skipped files journaled by an earlier run, with the hash their copy was verified against
+            std::vector<std::optional<quint64>> doneHashes;
+            QSet<QString> claimedPaths;
+            BoundedQueue<Chunk> writeQueue;
+            // Mirrors only: the first file it fell behind on, from there on files come from the primary's copies
+            int catchUpFrom = -1;
+            std::atomic<bool> failed = false;
+            std::unique_ptr<Manifest> manifest;
+            DestinationResult result;
+        };
+
+        void fetchStage();
+        // Decide where the file goes at this destination, false when it's already there
+        bool planFile(Destination& dest, int fileIndex, const DedupIndex::CameraFingerprint& cameraFingerprint,
+                      qint64& offset);
+        bool fetchFile(int fileIndex, qint64 offset, const QVector<Destination*>& targets);
+        // Hash the part of a resumed file that is already on disk, it doesn't come from the camera this time
+        static bool hashPrefix(const QString& filePath, qint64 size, Hash64& hasher);
+        // Queue a chunk for a destination, false when the import can't go on
+        bool send(Destination& dest, Chunk chunk);
+        void writeStage(int destination);
+        void verifyStage();
+        void deleteStage();
+
+        DedupIndex::CameraFingerprint cameraFingerprint(int fileIndex);
+        [[nodiscard]] TransferJournal::FileKey fileKey(int fileIndex) const;
+        // Don't clobber a different file of the same name, from an earlier card or another camera, or one another
+        // camera is importing into the same directory right now
+        QString uniqueOutFilePath(Destination& dest, int fileIndex);
+        void placed(int fileIndex);
+        // Block until the primary has the file in place, false if it never will
+        bool waitForPrimary(int fileIndex);
+        void fileDone(int fileIndex);
+        void fileRemoved(int fileIndex);
+        void reportProgress();
+        // A failing mirror only takes itself out, the primary fails the whole import
+        void failDestination(Destination& dest, const QString& error);
+        void fail(const QString& error, bool readError = false);
+        [[nodiscard]] bool failed() const;
+        [[nodiscard]] static QString tempFilePath(const Destination& dest, int fileIndex);
+
+        const std::shared_ptr<CameraSession> mSession;
+        const bool mRemoveOriginals;
+        int mDeleteBatchSize = 0;
+        QString mDeviceName;
+        QString mCameraIdentity;
+        ProgressCallback mProgressCallback;
+        FileDoneCallback mFileDoneCallback;
+        CancelToken mCancel;
+        std::shared_ptr<BusLane> mBusLane;
+        // The primary comes first
+        std::vector<std::unique_ptr<Destination>> mDestinations;
+
+        FileSnapshot mFiles;
+        // Destinations still to verify each file, the original stays on the camera until they all have
+        std::unique_ptr<std::atomic<int>[]> mPendingDestinations;
+        // Some destination skipped the file without a copy it could verify, the original can't go
+        std::unique_ptr<std::atomic<bool>[]> mUnverified;
+        QVector<bool> mSkippedEverywhere;
+        // Of the bytes read from the camera, set before the last chunk of a file is queued
+        std::vector<std::optional<quint64>> mHashes;
+        std::atomic<int> mRunningVerifiers = 0;
+        BoundedQueue<WrittenFile> mVerifyQueue;
+        BoundedQueue<int> mDeleteQueue;
+
+        // Which files the primary has in place, for mirrors catching up
+        std::vector<bool> mPlaced;
+        bool mPrimaryFinished = false;
+        std::mutex mPlacedMutex;
+        std::condition_variable mPlacedChanged;
+
+        std::atomic<qint64> mTransferredBytes = 0;
+        std::atomic<qint64> mSkippedBytes = 0;
+        std::atomic<bool> mFailed = false;
+        std::mutex mResultMutex;
+        Result mResult;
+    };
+
+}
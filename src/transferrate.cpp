@@ -0,0 +1,36 @@
+#include "transferrate.h"
+
+#include <cmath>
+
+using namespace CamWatcher;
+
+namespace {
+    // Shorter samples are too noisy to be worth averaging in
+    constexpr auto sampleInterval = std::chrono::milliseconds(250);
+    // Roughly how far back the average looks, in seconds
+    constexpr double smoothingSeconds = 5.0;
+}
+
+std::optional<TransferRate::Estimate> TransferRate::update(const qint64 transferredBytes, const qint64 remainingBytes,
+                                                           const bool force) {
+    std::lock_guard lock(mMutex);
+    const auto now = Clock::now();
+
+    const std::chrono::duration<double> sampleTime = now - mLastSample;
+    if (now - mLastSample >= sampleInterval) {
+        const double sampleRate = (transferredBytes - mLastSampleBytes) / sampleTime.count();
+        // Weighted by elapsed time, so irregular samples still decay at the same pace
+        const double alpha = 1.0 - std::exp(-sampleTime.count() / smoothingSeconds);
+        mRate = mRate ? *mRate + alpha * (sampleRate - *mRate) : sampleRate;
+        mLastSample = now;
+        mLastSampleBytes = transferredBytes;
+    }
+
+    if (!force && now - mLastUpdate < std::chrono::milliseconds(1000 / updatesPerSecond))
+        return std::nullopt;
+    mLastUpdate = now;
+
+    const double rate = mRate ? qMax(0.0, *mRate) : 0.0;
+    const int secondsRemaining = rate > 0 ? static_cast<int>(qMax<qint64>(0, remainingBytes) / rate) : -1;
+    return Estimate{rate, secondsRemaining};
+}
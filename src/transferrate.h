@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QtGlobal>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+namespace CamWatcher {
+
+    /**
+     * Smoothed throughput and time remaining of a transfer, from a running byte count.
+     * Also decides when an update is worth showing, so the gui is told at most updatesPerSecond times a second
+     * however fast the bytes come in. Thread safe.
+     */
+    class TransferRate {
+    public:
+        struct Estimate {
+            double bytesPerSecond;
+            // -1 while there is nothing to base it on yet
+            int secondsRemaining;
+        };
+
+        static constexpr int updatesPerSecond = 20;
+
+        /**
+         * Feed the bytes moved so far and the bytes still to go.
+         * Returns an estimate when it's time for an update, force to always get one (eg: a file completed).
+         */
+        std::optional<Estimate> update(qint64 transferredBytes, qint64 remainingBytes, bool force = false);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        Clock::time_point mLastSample = Clock::now();
+        qint64 mLastSampleBytes = 0;
+        Clock::time_point mLastUpdate;
+        // Bytes per second, exponentially weighted so a single stall or burst doesn't throw the ETA around
+        std::optional<double> mRate;
+        std::mutex mMutex;
+    };
+
+}
@@ -0,0 +1,142 @@
+#include "transferscheduler.h"
+
+#include "sysfs.h"
+
+#include <QSettings>
+#include <QtDebug>
+
+using namespace CamWatcher;
+
+namespace {
+    // Most of the time they wait on the camera, not the cpu
+    constexpr int defaultWorkerThreads = 4;
+
+    // All of them, one is kept for interactive jobs so there have to be at least two
+    int workerThreads() {
+        return qMax(2, QSettings().value("transfer/workerThreads", defaultWorkerThreads).toInt());
+    }
+}
+
+BusLane::BusLane(const int slotCount) : mSlots(qMax(1, slotCount)) {}
+
+void BusLane::acquire() {
+    std::unique_lock lock(mMutex);
+    const auto ticket = mNextTicket++;
+    mWaiting.push_back(ticket);
+    mCondition.wait(lock, [this, ticket] { return mActive < mSlots && mWaiting.front() == ticket; });
+    mWaiting.pop_front();
+    mActive++;
+    mCondition.notify_all();
+}
+
+void BusLane::release() {
+    std::lock_guard lock(mMutex);
+    mActive--;
+    mCondition.notify_all();
+}
+
+TransferScheduler::TransferScheduler()
+    : mSlotsPerLane(QSettings().value("transfer/camerasPerLane", 1).toInt()),
+      mMaxBulkJobs(workerThreads() - 1) {
+    // One more than may import, so there's always a worker for interactive jobs
+    for (int i = 0; i < mMaxBulkJobs + 1; i++) mWorkers.emplace_back(&TransferScheduler::work, this);
+}
+
+TransferScheduler::~TransferScheduler() {
+    shutdown();
+}
+
+std::shared_ptr<BusLane> TransferScheduler::lane(const int bus, const int port) {
+    const auto sysfsDev = findSysfsUsbDevice(bus, port);
+    const auto key = sysfsDev ? sysfsDev->rootPort() : QString("bus%1").arg(bus);
+
+    std::lock_guard lock(mMutex);
+    auto& lane = mLanes[key];
+    if (!lane) {
+        qInfo() << "New transfer lane" << key;
+        lane = std::make_shared<BusLane>(mSlotsPerLane);
+    }
+    return lane;
+}
+
+void TransferScheduler::run(const Priority priority, std::function<void()> job) {
+    run({}, priority, std::move(job));
+}
+
+void TransferScheduler::run(const QString& strand, const Priority priority, std::function<void()> job) {
+    {
+        std::lock_guard lock(mJobsMutex);
+        if (mStopping)
+            return;
+
+        Job newJob{strand, priority, std::move(job)};
+        if (!strand.isEmpty()) {
+            if (const auto it = mStrands.find(strand); it != mStrands.end()) {
+                it->push_back(std::move(newJob));
+                return;
+            }
+            mStrands.insert(strand, {});
+        }
+        (priority == Priority::Interactive ? mInteractiveJobs : mBulkJobs).push_back(std::move(newJob));
+    }
+    mJobsChanged.notify_one();
+}
+
+void TransferScheduler::shutdown() {
+    {
+        std::lock_guard lock(mJobsMutex);
+        mStopping = true;
+        mInteractiveJobs.clear();
+        mBulkJobs.clear();
+        mStrands.clear();
+    }
+    mJobsChanged.notify_all();
+    for (auto& worker: mWorkers) {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+void TransferScheduler::work() {
+    std::unique_lock lock(mJobsMutex);
+    while (true) {
+        std::deque<Job>* queue = nullptr;
+        mJobsChanged.wait(lock, [this, &queue] { return mStopping || (queue = nextQueue()); });
+        if (mStopping)
+            return;
+
+        auto job = std::move(queue->front());
+        queue->pop_front();
+        const bool bulk = job.priority == Priority::Bulk;
+        if (bulk)
+            mRunningBulkJobs++;
+
+        lock.unlock();
+        job.func();
+        // Let go of what the job holds on to before the next one runs
+        job.func = nullptr;
+        lock.lock();
+
+        if (bulk)
+            mRunningBulkJobs--;
+        // Hand the strand to its next job
+        if (const auto it = mStrands.find(job.strand); it != mStrands.end()) {
+            if (it->empty()) {
+                mStrands.erase(it);
+            } else {
+                auto next = std::move(it->front());
+                it->pop_front();
+                (next.priority == Priority::Interactive ? mInteractiveJobs : mBulkJobs).push_back(std::move(next));
+            }
+        }
+        mJobsChanged.notify_all();
+    }
+}
+
+std::deque<TransferScheduler::Job>* TransferScheduler::nextQueue() {
+    if (!mInteractiveJobs.empty())
+        return &mInteractiveJobs;
+    if (!mBulkJobs.empty() && mRunningBulkJobs < mMaxBulkJobs)
+        return &mBulkJobs;
+    return nullptr;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CamWatcher {
+
+    /**
+     * A shared USB link (bus + root port) that only so many cameras may use at once.
+     * Waiters are served in arrival order, so cameras that hold the lane per file end up taking turns.
+     */
+    class BusLane {
+    public:
+        explicit BusLane(int slotCount);
+
+        void acquire();
+        void release();
+
+        class Slot {
+        public:
+            explicit Slot(BusLane* lane) : mLane(lane) {
+                if (mLane)
+                    mLane->acquire();
+            }
+            ~Slot() {
+                if (mLane)
+                    mLane->release();
+            }
+            Slot(const Slot&) = delete;
+            Slot& operator=(const Slot&) = delete;
+
+        private:
+            BusLane* mLane;
+        };
+
+    private:
+        const int mSlots;
+        int mActive = 0;
+        quint64 mNextTicket = 0;
+        std::deque<quint64> mWaiting;
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+    };
+
+    /**
+     * Runs camera jobs on a fixed set of worker threads and hands out the BusLane each camera sits on.
+     * Cameras on different buses or root ports transfer in parallel, cameras sharing one are time-sliced.
+     *
+     * Jobs on the same strand (eg: one camera) run one at a time, in the order they were queued, so two sessions
+     * never fight over a device. Interactive jobs are picked before bulk ones, and bulk jobs never take the last
+     * worker, so listing a camera that was just plugged in doesn't wait for another camera's import.
+     */
+    class TransferScheduler {
+    public:
+        enum class Priority {
+            // Someone is waiting on it: detecting, listing
+            Interactive,
+            // Imports
+            Bulk,
+        };
+
+        TransferScheduler();
+        ~TransferScheduler();
+
+        // The lane for the device gphoto2 knows as usb:bus,port
+        std::shared_ptr<BusLane> lane(int bus, int port);
+        // A job that doesn't need to wait for anything else
+        void run(Priority priority, std::function<void()> job);
+        // After the jobs queued on the strand before it are done
+        void run(const QString& strand, Priority priority, std::function<void()> job);
+        // Drop the jobs that haven't started and wait for the running ones
+        void shutdown();
+
+    private:
+        struct Job {
+            QString strand;
+            Priority priority;
+            std::function<void()> func;
+        };
+
+        void work();
+        // The queue to take the next job from, null when there's nothing the workers may start
+        std::deque<Job>* nextQueue();
+
+        const int mSlotsPerLane;
+        QMap<QString, std::shared_ptr<BusLane>> mLanes;
+        std::mutex mMutex;
+
+        std::vector<std::thread> mWorkers;
+        const int mMaxBulkJobs;
+        int mRunningBulkJobs = 0;
+        // Jobs that may start, one queue per priority
+        std::deque<Job> mInteractiveJobs;
+        std::deque<Job> mBulkJobs;
+        // A strand is in here while one of its jobs is queued or running, with the jobs waiting behind that one
+        QHash<QString, std::deque<Job>> mStrands;
+        bool mStopping = false;
+        std::mutex mJobsMutex;
+        std::condition_variable mJobsChanged;
+    };
+
+}
@@ -0,0 +1,71 @@
+#include "udevmonitor.h"
+
+#include <QSocketNotifier>
+#include <libudev.h>
+
+using namespace CamWatcher;
+
+namespace {
+    // Long enough to catch every device behind a hub that just powered on
+    constexpr int debounceMs = 250;
+}
+
+UdevMonitor::UdevMonitor(QObject* parent) : QObject(parent) {
+    mDebounceTimer.setSingleShot(true);
+    mDebounceTimer.setInterval(debounceMs);
+    connect(&mDebounceTimer, &QTimer::timeout, this, &UdevMonitor::flushEvents);
+}
+
+UdevMonitor::~UdevMonitor() {
+    delete mNotifier;
+    if (mMonitor)
+        udev_monitor_unref(mMonitor);
+    if (mUdev)
+        udev_unref(mUdev);
+}
+
+QString UdevMonitor::start() {
+    mUdev = udev_new();
+    if (!mUdev)
+        return "Failed to create udev context";
+
+    // Events from udevd rather than the kernel, by then rules have run and gphoto2 may open the device
+    mMonitor = udev_monitor_new_from_netlink(mUdev, "udev");
+    if (!mMonitor)
+        return "Failed to create udev monitor";
+
+    // Installed as a socket filter, anything else never wakes us up
+    if (udev_monitor_filter_add_match_subsystem_devtype(mMonitor, "usb", "usb_device") < 0)
+        return "Failed to set udev monitor filter";
+    if (udev_monitor_enable_receiving(mMonitor) < 0)
+        return "Failed to enable udev monitor";
+
+    mNotifier = new QSocketNotifier(udev_monitor_get_fd(mMonitor), QSocketNotifier::Read);
+    connect(mNotifier, &QSocketNotifier::activated, this, &UdevMonitor::readEvents);
+    return {};
+}
+
+void UdevMonitor::readEvents() {
+    // Drain the socket, the notifier fires again if more arrives
+    while (auto dev = udev_monitor_receive_device(mMonitor)) {
+        const QString action = udev_device_get_action(dev);
+        // Properties rather than sysfs attributes, those are gone by the time a remove arrives
+        const int busNum = QString(udev_device_get_property_value(dev, "BUSNUM")).toInt();
+        const int devNum = QString(udev_device_get_property_value(dev, "DEVNUM")).toInt();
+
+        // Interfaces only exist once a driver is bound, "add" comes too early to tell what the device is
+        if (busNum > 0 && devNum > 0 && (action == "bind" || action == "unbind" || action == "remove")) {
+            mPendingEvents.insert({busNum, devNum}, action == "bind");
+            mDebounceTimer.start();
+        }
+        udev_device_unref(dev);
+    }
+}
+
+void UdevMonitor::flushEvents() {
+    QVector<UsbEvent> events;
+    for (auto it = mPendingEvents.cbegin(); it != mPendingEvents.cend(); ++it)
+        events.append({it.value(), it.key().first, it.key().second});
+    mPendingEvents.clear();
+    devicesChanged(events);
+}
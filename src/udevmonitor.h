@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QTimer>
+#include <QVector>
+
+struct udev;
+struct udev_monitor;
+class QSocketNotifier;
+
+namespace CamWatcher {
+
+    struct UsbEvent {
+        // Ready to talk to, or gone
+        bool added;
+        int busNum;
+        int devNum;
+    };
+
+    /**
+     * Listens for USB devices coming and going on the udev netlink socket.
+     * Events arriving in a burst (a hub powering up several cameras) are delivered together in one devicesChanged(),
+     * with only the last event per device.
+     */
+    class UdevMonitor final : public QObject {
+        Q_OBJECT
+    public:
+        explicit UdevMonitor(QObject* parent = nullptr);
+        ~UdevMonitor() override;
+
+        // Empty on success
+        QString start();
+
+    Q_SIGNALS:
+        void devicesChanged(const QVector<CamWatcher::UsbEvent>& events);
+
+    private:
+        void readEvents();
+        void flushEvents();
+
+        udev* mUdev = nullptr;
+        udev_monitor* mMonitor = nullptr;
+        QSocketNotifier* mNotifier = nullptr;
+        QTimer mDebounceTimer;
+        QMap<QPair<int, int>, bool> mPendingEvents;
+    };
+
+}
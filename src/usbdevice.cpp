@@ -1,4 +1,6 @@
 #include "usbdevice.h"
+#include "camerabackend.h"
+#include "usbmanager.h"
 #include "utils.h"
 
 #include <QFileInfo>
@@ -7,8 +9,8 @@
 
 using namespace CamWatcher;
 
-UsbFile::UsbFile(QString filePath, const int kbSize)
-    : mFilePath(std::move(filePath)),  mKbSize(kbSize){}
+UsbFile::UsbFile(QString filePath, const int kbSize, const qint64 timestamp)
+    : mFilePath(std::move(filePath)),  mKbSize(kbSize), mTimestamp(timestamp){}
 
 
 QString UsbFile::filePath() const {
@@ -19,16 +21,28 @@ int UsbFile::kbSize() const {
     return mKbSize;
 }
 
-UsbDevice::UsbDevice(UsbManager& usbManager, const QString& name, const int bus, const int port)
-    : mUsbManager(usbManager), mName(name), mBus(bus), mPort(port), mSettingsKey(name), mState(Idle) {}
+qint64 UsbFile::timestamp() const {
+    return mTimestamp;
+}
+
+UsbDevice::UsbDevice(UsbManager& usbManager, const QString& name, const int bus, const int port,
+                     ImportCatalog catalog)
+    : mUsbManager(usbManager), mName(name), mSlug(qSlugify(name)), mBus(bus), mPort(port), mSettingsKey(name),
+      mIdentity(catalog.identity()), mCatalog(std::move(catalog)), mState(Idle) {}
 
 void UsbDevice::setState(const State state, const StateParm& parm) {
-    invokeOnMainThread([this, state, parm] {
+    const auto apply = [this, state, parm] {
         if (mState == state && mStateParm == parm)
             return;
 
         forceState(state, parm);
-    });
+    };
+    // Only the latest progress matters, skip any the gui hasn't gotten around to yet. Everything else is a real
+    // transition and arrives in order.
+    if (state == Copy && parm.canConvert<CopyStats>())
+        invokeOnMainThread(this, apply);
+    else
+        invokeOnMainThread(apply);
 }
 
 void UsbDevice::resetState() {
@@ -39,6 +53,18 @@ const QString& UsbDevice::name() const {
     return mName;
 }
 
+const QString& UsbDevice::slug() const {
+    return mSlug;
+}
+
+const QString& UsbDevice::identity() const {
+    return mIdentity;
+}
+
+void UsbDevice::setCatalog(ImportCatalog catalog) {
+    mCatalog = std::move(catalog);
+}
+
 int UsbDevice::bus() const {
     return mBus;
 }
@@ -51,16 +77,54 @@ const UsbDevice::State& UsbDevice::state() const {
     return mState;
 }
 
-const QVector<UsbFile>& UsbDevice::files() const {
-    return mFiles;
+FileSnapshot UsbDevice::files() const {
+    return mCatalog.files();
 }
 
-void UsbDevice::setFiles(const QVector<UsbFile>& filePaths) {
-    mFiles = filePaths;
+void UsbDevice::beginListing() {
+    mListing = {};
+}
+
+void UsbDevice::appendListedFiles(const QVector<UsbFile>& files) {
+    for (const auto& f: files) mListing.append(f);
+}
+
+int UsbDevice::listedFileCount() const {
+    return mListing.size();
+}
+
+void UsbDevice::finishListing() {
+    mCatalog.update(mListing.build());
+    mCatalog.save();
+}
+
+FileSnapshot UsbDevice::copyableUsbFiles() const {
+    const auto files = mCatalog.files();
+    FileCatalog::Builder builder;
+    for (int i = 0; i < files->size(); i++) {
+        if (!mCatalog.isImported(i))
+            builder.append(*files, i);
+    }
+    return builder.build();
 }
 
 int UsbDevice::fileCount() const {
-    return files().size();
+    return files()->size();
+}
+
+int UsbDevice::newFileCount() const {
+    return mCatalog.newFileCount();
+}
+
+void UsbDevice::markImported(const QString& filePath, const bool removed) {
+    mCatalog.markImported(filePath);
+    if (removed)
+        mCatalog.remove(filePath);
+}
+
+void UsbDevice::finishImport() {
+    mCatalog.compact();
+    mCatalog.save();
 }
 
 QString UsbDevice::destFilePath() const {
@@ -79,10 +143,41 @@ void UsbDevice::setDestFilePath(const QString& path) const {
     s.sync();
 }
 
+QStringList UsbDevice::mirrorPaths() const {
+    QSettings s;
+    s.beginGroup(mSettingsKey);
+    const auto value = s.value("mirrorPaths").toStringList();
+    s.endGroup();
+    return value;
+}
+
+void UsbDevice::setMirrorPaths(const QStringList& paths) const {
+    QSettings s;
+    s.beginGroup(mSettingsKey);
+    s.setValue("mirrorPaths", paths);
+    s.endGroup();
+    s.sync();
+}
+
+QString UsbDevice::autoImport() const {
+    QSettings s;
+    s.beginGroup(mSettingsKey);
+    const auto value = s.value("autoImport").toString();
+    s.endGroup();
+    return value;
+}
+
 UsbManager& UsbDevice::usbManager() const {
     return mUsbManager;
 }
 
+std::shared_ptr<CameraSession> UsbDevice::session() {
+    std::lock_guard lock(mSessionMutex);
+    if (!mSession)
+        mSession = mUsbManager.backend().openSession(mName, mBus, mPort);
+    return mSession;
+}
+
 void UsbDevice::forceState(const State state, const StateParm& parm) {
     const auto msg = QString("[STATE(%1)] %2 (%3)").arg(name(), QMetaEnum::fromType<State>().valueToKey(state), parm.toString());
     qDebug() << msg;
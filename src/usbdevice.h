@@ -1,7 +1,13 @@
 #pragma once
 
 
+#include "importcatalog.h"
+
+#include <QObject>
 #include <QSettings>
+#include <QStringList>
+#include <memory>
+#include <mutex>
 #include <utility>
 
 namespace CamWatcher {
@@ -9,16 +15,20 @@ namespace CamWatcher {
     using StateParm = QVariant;
 
     class UsbManager;
+    class CameraSession;
 
     class UsbFile {
     public:
-        UsbFile(QString filePath, int kbSize);
+        UsbFile(QString filePath, int kbSize, qint64 timestamp = 0);
         [[nodiscard]] QString filePath() const;
         [[nodiscard]] int kbSize() const;
+        // Modification time on the camera, seconds since epoch, 0 if unknown
+        [[nodiscard]] qint64 timestamp() const;
 
     private:
         QString mFilePath;
         int mKbSize;
+        qint64 mTimestamp;
     };
 
     class UsbDevice final : public QObject {
@@ -36,22 +46,45 @@ namespace CamWatcher {
         };
         Q_ENUM(State)
 
-        UsbDevice(UsbManager& usbMan, const QString& name, int bus, int port);
+        // The catalog comes loaded, reading it from disk is kept off the gui thread
+        UsbDevice(UsbManager& usbMan, const QString& name, int bus, int port, ImportCatalog catalog);
 
         [[nodiscard]] const State& state() const;
         void setState(State state, const StateParm& parm = {});
         void resetState();
         [[nodiscard]] const QString& name() const;
+        // The name as used in paths, computed once
+        [[nodiscard]] const QString& slug() const;
+        // Stays the same for this camera across ports and sessions
+        [[nodiscard]] const QString& identity() const;
+        // For a device restored from last time, once its catalog is loaded. Same identity as the device.
+        void setCatalog(ImportCatalog catalog);
         [[nodiscard]] int bus() const;
         [[nodiscard]] int port() const;
         [[nodiscard]] const StateParm& stateParm() const;
-        [[nodiscard]] const QVector<UsbFile>& files() const;
-        void setFiles(const QVector<UsbFile>& filePaths);
-        [[nodiscard]] QVector<UsbFile> copyableUsbFiles() const;
+        [[nodiscard]] FileSnapshot files() const;
+        // Collect files while listing, they replace the current files (and update the catalog) in finishListing()
+        void beginListing();
+        void appendListedFiles(const QVector<UsbFile>& files);
+        [[nodiscard]] int listedFileCount() const;
+        void finishListing();
+        // Files not imported yet, empty when all of them were
+        [[nodiscard]] FileSnapshot copyableUsbFiles() const;
         [[nodiscard]] int fileCount() const;
+        [[nodiscard]] int newFileCount() const;
+        void markImported(const QString& filePath, bool removed);
+        // Apply the files marked imported (or removed) to the file list and persist the catalog
+        void finishImport();
         [[nodiscard]] QString destFilePath() const;
         void setDestFilePath(const QString& path) const;
+        // Extra destinations that get a copy of every file during the same import, e.g. a backup drive
+        [[nodiscard]] QStringList mirrorPaths() const;
+        void setMirrorPaths(const QStringList& paths) const;
+        // What the headless mode does when the camera shows up: "copy", "move" or "off", empty when not set
+        [[nodiscard]] QString autoImport() const;
         UsbManager& usbManager() const;
+        // The camera connection, opened on first use and shared by all operations on this device
+        std::shared_ptr<CameraSession> session();
 
     Q_SIGNALS:
         void stateChanged(State state, StateParm parm);
@@ -61,12 +94,18 @@ namespace CamWatcher {
 
         UsbManager& mUsbManager;
         QString mName;
+        QString mSlug;
         int mBus;
         int mPort;
 
         QString mSettingsKey;
+        // Apart from the catalog, thumbnail workers read it while the catalog may be replaced
+        const QString mIdentity;
 
-        QVector<UsbFile> mFiles;
+        ImportCatalog mCatalog;
+        FileCatalog::Builder mListing;
+        std::shared_ptr<CameraSession> mSession;
+        std::mutex mSessionMutex;
         State mState;
         StateParm mStateParm;
     };
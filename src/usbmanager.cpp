@@ -1,77 +1,225 @@
 #include "usbmanager.h"
 
+#include "mediafiles.h"
+#include "metrics.h"
+#include "sysfs.h"
+#include "transferpipeline.h"
+#include "transferrate.h"
 #include "utils.h"
 
 #include <QDateTime>
 #include <QDir>
-#include <QProcess>
-#include <QRegularExpressionMatch>
 #include <QSet>
+#include <QSettings>
 #include <QtDebug>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 
 using namespace CamWatcher;
 
-QString createPortPath(const int bus, const int port) {
-    const auto busStr = QString("%1").arg(bus, 3, 10, QChar('0'));
-    const auto portStr = QString("%1").arg(port, 3, 10, QChar('0'));
-    return QString("usb:%1,%2").arg(busStr, portStr);
-}
+namespace {
+    constexpr auto probingText = "Probing...";
 
-const QString& patBus() {
-    static const QString pat(R"((.+)\W\W\Wusb:(\d\d\d),(\d\d\d))");
-    return pat;
-}
+    // Everything that talks to one camera runs on the same strand
+    QString strand(const UsbDevice& dev) {
+        return createPortPath(dev.bus(), dev.port());
+    }
+
+    // Something that stays the same for a camera no matter which port it is plugged into
+    QString cameraIdentity(const QString& name, const int bus, const int port) {
+        const auto sysfsDev = findSysfsUsbDevice(bus, port);
+        if (!sysfsDev)
+            return name;
 
-const QRegularExpression& reBus() {
-    static const QRegularExpression re(patBus());
-    return re;
+        const auto serial = sysfsDev->attribute("serial");
+        return QString("%1:%2:%3")
+                .arg(sysfsDev->attribute("idVendor"), sysfsDev->attribute("idProduct"),
+                     serial.isEmpty() ? name : serial);
+    }
 }
 
-UsbManager::UsbManager() {
-    refreshDevices();
+UsbManager::UsbManager(std::unique_ptr<CameraBackend> backend) : mBackend(std::move(backend)) {
+    restoreKnownDevices();
     listenForEvents();
+    Metrics::instance().watchDumpSignal();
+    refreshDevices();
 }
 
 UsbManager::~UsbManager() {
-    mDetectProcess.close();
+    // Jobs still running use the devices, they have to be over first
+    for (const auto& cancels: mImportCancels) {
+        for (const auto& cancel: cancels) cancel.cancel();
+    }
+    mScheduler.shutdown();
 }
 
 void UsbManager::refreshDevices() {
-    ProcOutput output = runCmd({"gphoto2", "--auto-detect"});
+    // Detecting can take seconds, the gui shows the last known devices meanwhile
+    mScheduler.run(TransferScheduler::Priority::Interactive, [this] {
+        StageTimer timer("detect");
+        QVector<DetectedCamera> cameras;
+        const auto err = mBackend->detectCameras(cameras);
+        // Which of them the gui already knows isn't known here, so every one gets its catalog
+        QVector<FoundCamera> found;
+        for (const auto& camera: cameras) found.append(findCatalog(camera));
+        invokeOnMainThread([this, found, err] { applyDetectedCameras(found, err); });
+    });
+}
 
-    if (output.hasError()) {
-        qFatal("Failed to wait for process");
-    }
+UsbManager::FoundCamera UsbManager::findCatalog(const DetectedCamera& camera) {
+    const auto catalog = std::make_shared<ImportCatalog>(cameraIdentity(camera.name, camera.bus, camera.port));
+    catalog->load();
+    return {camera, catalog};
+}
+
+void UsbManager::applyDetectedCameras(const QVector<FoundCamera>& cameras, const QString& err) {
+    if (!err.isEmpty())
+        qWarning() << "Failed to detect cameras:" << err;
 
     QSet<QPair<int, int>> connectedPorts;
-    for (const auto& line: splitLines(output.out)) {
+    for (const auto& [camera, catalog]: cameras) {
+        connectedPorts.insert({camera.bus, camera.port});
+
+        const auto dev = device(camera.bus, camera.port);
+        if (!dev) {
+            addDevice(camera, *catalog);
+        } else if (mProbing.remove(dev)) {
+            if (dev->name() == camera.name && dev->identity() == catalog->identity()) {
+                dev->setCatalog(*catalog);
+                dev->setState(UsbDevice::Idle);
+                listFiles(*dev);
+            } else {
+                // Another camera got the same device number
+                removeDevice(dev);
+                addDevice(camera, *catalog);
+            }
+        }
+    }
+
+    // Hot plugged devices may have come in while detecting, only the last known ones are in doubt
+    for (int i = mDevices.size() - 1; i >= 0; i--) {
+        const auto dev = mDevices[i].get();
+        if (mProbing.contains(dev) && !connectedPorts.contains({dev->bus(), dev->port()})) {
+            mProbing.remove(dev);
+            removeDevice(dev);
+        }
+    }
+}
 
-        auto match = reBus().match(line);
-        if (!match.hasMatch())
+void UsbManager::handleUsbEvents(const QVector<UsbEvent>& events) {
+    QVector<QPair<int, int>> addedPorts;
+    for (const auto& [added, bus, port]: events) {
+        if (!added) {
+            if (const auto dev = device(bus, port)) {
+                mProbing.remove(dev);
+                removeDevice(dev);
+            }
             continue;
+        }
+
+        if (!device(bus, port))
+            addedPorts.append({bus, port});
+    }
+    if (addedPorts.isEmpty())
+        return;
+
+    // Probing may ask gphoto2, keep it off the gui thread
+    mScheduler.run(TransferScheduler::Priority::Interactive, [this, addedPorts] {
+        QVector<FoundCamera> cameras;
+        for (const auto& [bus, port]: addedPorts) {
+            // Keyboards, drives and the like are turned away without asking gphoto2
+            const auto sysfsDev = findSysfsUsbDevice(bus, port);
+            if (sysfsDev && !sysfsDev->mayBeCamera())
+                continue;
 
-        const auto name = match.captured(1).trimmed();
-        const int bus = match.captured(2).toInt();
-        const int port = match.captured(3).toInt();
-        connectedPorts.insert({bus, port});
-
-        if (const auto dev = device(bus, port); !dev) {
-            // Add device
-            auto newDevice = std::make_unique<UsbDevice>(*this, name, bus, port);
-            const auto devPtr = newDevice.get();
-            mDevices.emplace_back(std::move(newDevice));
-            deviceAdded(devPtr);
-            listFiles(*devPtr);
+            std::optional<DetectedCamera> camera;
+            if (const auto err = mBackend->detectCamera(bus, port, camera); !err.isEmpty()) {
+                qWarning() << "Failed to probe" << createPortPath(bus, port) << err;
+                continue;
+            }
+            if (camera)
+                cameras.append(findCatalog(*camera));
         }
+
+        invokeOnMainThread([this, cameras] {
+            for (const auto& [camera, catalog]: cameras) {
+                if (!device(camera.bus, camera.port))
+                    addDevice(camera, *catalog);
+            }
+        });
+    });
+}
+
+void UsbManager::addDevice(const DetectedCamera& camera, ImportCatalog catalog, const bool probing) {
+    auto newDevice = std::make_unique<UsbDevice>(*this, camera.name, camera.bus, camera.port, std::move(catalog));
+    const auto devPtr = newDevice.get();
+    mDevices.emplace_back(std::move(newDevice));
+    if (probing)
+        mProbing.insert(devPtr);
+    else
+        saveKnownDevices();
+
+    deviceAdded(devPtr);
+    if (probing)
+        devPtr->setState(UsbDevice::Init, probingText);
+    else
+        listFiles(*devPtr);
+}
+
+void UsbManager::removeDevice(UsbDevice* dev) {
+    const auto it = std::find_if(mDevices.begin(), mDevices.end(), [dev](const auto& d) { return d.get() == dev; });
+    if (it == mDevices.end())
+        return;
+
+    deviceAboutToBeRemoved(dev);
+    auto removed = std::move(*it);
+    mDevices.erase(it);
+    // A job still running uses the device until it gives up on the camera
+    if (mJobs.contains(dev))
+        mUnplugged.emplace_back(std::move(removed));
+    saveKnownDevices();
+    deviceRemoved();
+}
+
+void UsbManager::restoreKnownDevices() {
+    QSettings s;
+    const int count = s.beginReadArray("knownDevices");
+    for (int i = 0; i < count; i++) {
+        s.setArrayIndex(i);
+        const auto name = s.value("name").toString();
+        // Its catalog is loaded by the detect job, once the camera turns out to still be there
+        ImportCatalog catalog(s.value("identity", name).toString());
+        addDevice({name, s.value("bus").toInt(), s.value("port").toInt()}, std::move(catalog), true);
     }
+    s.endArray();
+}
 
-    for (int i = mDevices.size() - 1; i >= 0; i--) {
-        auto& oldDev = mDevices[i];
-        if (!connectedPorts.contains({oldDev->bus(), oldDev->port()})) {
-            // Remove device
-            deviceAboutToBeRemoved(oldDev.get());
-            mDevices.erase(mDevices.begin() + i);
-            deviceRemoved();
+void UsbManager::saveKnownDevices() const {
+    QSettings s;
+    s.beginWriteArray("knownDevices", static_cast<int>(mDevices.size()));
+    for (int i = 0; i < static_cast<int>(mDevices.size()); i++) {
+        s.setArrayIndex(i);
+        s.setValue("name", mDevices[i]->name());
+        s.setValue("identity", mDevices[i]->identity());
+        s.setValue("bus", mDevices[i]->bus());
+        s.setValue("port", mDevices[i]->port());
+    }
+    s.endArray();
+}
+
+void UsbManager::beginJob(UsbDevice* dev) {
+    mJobs[dev]++;
+}
+
+void UsbManager::endJob(UsbDevice* dev) {
+    if (--mJobs[dev] > 0)
+        return;
+    mJobs.remove(dev);
+    for (auto it = mUnplugged.begin(); it != mUnplugged.end(); ++it) {
+        if (it->get() == dev) {
+            mUnplugged.erase(it);
+            return;
         }
     }
 }
@@ -92,217 +240,285 @@ int UsbManager::deviceCount() const {
     return mDevices.size();
 }
 
+CameraBackend& UsbManager::backend() const {
+    return *mBackend;
+}
+
+std::shared_ptr<BusLane> UsbManager::busLane(const int bus, const int port) {
+    return mScheduler.lane(bus, port);
+}
+
 void UsbManager::listFiles(UsbDevice& dev) {
     int bus = dev.bus();
     int port = dev.port();
 
-    dev.setState(UsbDevice::Init, "Listing files...");
-
-    QThread* thread = QThread::create([this, bus, port] {
-        const auto portPath = createPortPath(bus, port);
-        ProcOutput output = runCmd({"gphoto2", "--list-files", "--port=" + portPath});
+    // With a catalog from last time the cached files stay usable while we look for changes
+    if (dev.fileCount() == 0)
+        dev.setState(UsbDevice::Init, "Listing files...");
 
-        if (output.hasError()) {
-            invokeOnMainThread([this, output, bus, port] {
-                if (const auto d = device(bus, port))
-                    d->setState(UsbDevice::Error, output.err);
-            });
-            return;
-        }
+    const auto devPtr = &dev;
+    beginJob(devPtr);
 
-        static const QSet<QString> imageExtensions{"png", "jpg", "jpeg", "gif", "3fr", "ari", "arw", "bay", "braw",
-                                                   "cri", "crw", "cap",  "dcs", "dng", "erf", "fff", "gpr", "jxs",
-                                                   "mef", "mdc", "mos",  "mrw", "nef", "orf", "pef", "pxn", "R3D",
-                                                   "raf", "raw", "raw",  "rwz", "srw", "tco", "x3f"};
-        static const QSet<QString> videoExtensions{
-                "webm", "mkv", "flv", "vob", "ogv", "ogg", "rrc", "gifv", "mng", "mov",  "avi", "qt",  "wmv",
-                "yuv",  "rm",  "asf", "amv", "mp4", "m4p", "m4v", "mpg",  "mp2", "mpeg", "mpe", "mpv", "m4v",
-                "svi",  "3gp", "3g2", "mxf", "roq", "nsv", "flv", "f4v",  "f4p", "f4a",  "f4b", "mod"};
-        static const QSet<QString> allowedExtensions = imageExtensions | videoExtensions;
-        static const QRegularExpression reFolder("There are \\d+ files in folder '([^']+)'");
-        static const QRegularExpression reFile(R"(#(\d+)\W+([\w|.]+)\W+(\w+)\W+(\d+)\W+KB\W+(.+))");
-
-        QString currentFolder;
-        QVector<UsbFile> paths;
-
-        for (const auto& line: splitLines(output.out)) {
-
-            if (auto folderMatch = reFolder.match(line); folderMatch.hasMatch()) {
-                currentFolder = folderMatch.captured(1);
-                continue;
-            }
+    const auto list = [this, bus, port, devPtr] {
+        // Not before, a listing queued behind another one would mix its files into that one's
+        invokeOnMainThread([this, bus, port] {
+            if (const auto d = device(bus, port))
+                d->beginListing();
+        });
 
-            if (auto fileMatch = reFile.match(line); fileMatch.hasMatch()) {
-                QString fileName = fileMatch.captured(2);
+        // Opening may load the camera drivers, not on the gui thread
+        const auto session = devPtr->session();
 
-                if (auto suffix = QFileInfo(fileName).suffix().toLower(); !allowedExtensions.contains(suffix))
-                    continue;
+        // Hand every batch to the gui as it is parsed, so the file count goes up while listing
+        const auto onBatch = [this, bus, port](const QVector<UsbFile>& files) {
+            QVector<UsbFile> paths;
+            for (const auto& f: files) {
+                if (isMediaFile(f.filePath()))
+                    paths.append(f);
+            }
+            if (paths.isEmpty())
+                return;
 
-//                const int gPhotoIndex = fileMatch.captured(1).toInt();
-                const QString filePath = currentFolder + '/' + fileMatch.captured(2);
-//                const QString flags = fileMatch.captured(3);
-                const int kbSize = fileMatch.captured(4).toInt();
-//                const QString mediaType = fileMatch.captured(5);
-//                const int timeStamp = fileMatch.captured(6).toInt();
+            invokeOnMainThread([this, bus, port, paths] {
+                const auto d = device(bus, port);
+                if (!d)
+                    return;
+                d->appendListedFiles(paths);
 
-                paths.append({filePath, kbSize});
-            }
+                if (d->state() == UsbDevice::Init)
+                    d->setState(UsbDevice::Init, QString("Listing files... %1 found").arg(d->listedFileCount()));
+            });
+        };
+
+        QString err;
+        {
+            const auto lane = mScheduler.lane(bus, port);
+            BusLane::Slot slot(lane.get());
+            StageTimer timer("list", devPtr->slug());
+            err = session->listFiles(onBatch);
+        }
+        if (!err.isEmpty()) {
+            invokeOnMainThread([this, err, bus, port] {
+                if (const auto d = device(bus, port))
+                    d->setState(UsbDevice::Error, err);
+            });
+            return;
         }
 
-        invokeOnMainThread([this, bus, port, paths] {
+        invokeOnMainThread([this, bus, port] {
             const auto d = device(bus, port);
             if (!d)
                 return;
-            d->setFiles(paths);
+            d->finishListing();
 
             if (d->state() == UsbDevice::Idle || d->state() == UsbDevice::Init) {
-                d->setState(UsbDevice::Idle, QString("Files on device: %1").arg(paths.size()));
+                d->setState(UsbDevice::Idle, QString("Files on device: %1").arg(d->fileCount()));
             }
+            deviceListed(d);
         });
-    });
+    };
 
-    connect(thread, &QThread::finished, [thread] {
-        thread->deleteLater();
+    mScheduler.run(strand(dev), TransferScheduler::Priority::Interactive, [this, list, devPtr] {
+        list();
+        invokeOnMainThread([this, devPtr] { endJob(devPtr); });
     });
-
-    thread->start(QThread::LowPriority);
 }
 
-void UsbManager::downloadFiles(UsbDevice& usbDevice, bool removeOriginals) {
+void UsbManager::downloadFiles(UsbDevice& usbDevice, bool removeOriginals, const bool reimport) {
     int bus = usbDevice.bus();
     int port = usbDevice.port();
-    auto usbFiles = usbDevice.files();
+    auto usbFiles = reimport ? usbDevice.files() : usbDevice.copyableUsbFiles();
+    if (usbFiles->size() == 0) {
+        usbDevice.setState(UsbDevice::Done, "Nothing new to import");
+        return;
+    }
     auto destPath = usbDevice.destFilePath();
+    auto mirrorPaths = usbDevice.mirrorPaths();
+    auto identity = usbDevice.identity();
     auto copyingOrMoving = removeOriginals ? "Moving" : "Copying";
     usbDevice.setState(UsbDevice::Copy, QString("%1 files...").arg(copyingOrMoving));
 
-    QThread* thread = QThread::create([this, removeOriginals, bus, port, usbFiles, destPath] {
-        const auto portPath = createPortPath(bus, port);
+    const auto dev = &usbDevice;
+    beginJob(dev);
+    const CancelToken cancel;
+    mImportCancels[dev].append(cancel);
 
-        const auto dev = device(bus, port);
+    const auto download = [this, removeOriginals, bus, port, usbFiles, destPath, mirrorPaths, identity, dev, cancel] {
+        const auto copyStartTime = std::chrono::steady_clock::now();
+        // Opening may load the camera drivers, not on the gui thread
+        const auto session = dev->session();
 
-        const auto copyStartTime = QDateTime::currentSecsSinceEpoch();
-
-        int totalFiles = usbFiles.size();
-        int copiedFiles = 0;
-        int copiedKbs = 0;
+        const int totalFiles = usbFiles->size();
         int totalKbs = 0;
-        int kbps = 0;
-        for (const auto& f: usbFiles) totalKbs += f.kbSize();
-
-        for (const auto& usbFile: usbFiles) {
-            if (dev->state() == UsbDevice::Cancel) {
-                break;
-            }
+        for (int i = 0; i < totalFiles; i++) totalKbs += usbFiles->kbSize(i);
+        const qint64 totalBytes = static_cast<qint64>(totalKbs) * 1024;
+
+        // Called for every chunk, from more than one thread
+        const auto rate = std::make_shared<TransferRate>();
+        const auto lastCopiedFiles = std::make_shared<std::atomic<int>>(-1);
+        const auto notifyProgress = [removeOriginals, dev, totalFiles, totalKbs, totalBytes, rate, lastCopiedFiles,
+                                     cancel](int copiedFiles, qint64 transferredBytes, qint64 skippedBytes) {
+            // Don't take the device out of the cancelling state
+            if (cancel.isCancelled())
+                return;
+            const bool fileDone = lastCopiedFiles->exchange(copiedFiles) != copiedFiles;
+            const auto doneBytes = transferredBytes + skippedBytes;
+            const auto estimate = rate->update(transferredBytes, totalBytes - doneBytes, fileDone);
+            if (!estimate)
+                return;
 
-            // Notify GUI
-            if (copiedKbs) {
-                const auto elapsedTime = QDateTime::currentSecsSinceEpoch() - copyStartTime;
-                kbps = copiedKbs / static_cast<float>(elapsedTime);
+            // Notify gui
+            QVariant v;
+            const auto copiedKbs = static_cast<int>(doneBytes / 1024);
+            const auto kbps = static_cast<int>(estimate->bytesPerSecond / 1024);
+            v.setValue(CopyStats{removeOriginals, totalKbs, copiedKbs, totalFiles, copiedFiles, kbps,
+                                 estimate->secondsRemaining});
+            dev->setState(UsbDevice::Copy, v);
+        };
+        notifyProgress(0, 0, 0);
+
+        // Construct a nice path to dump to
+        auto outDirPath = destPath + '/' + dev->slug();
+
+        // Make sure dest dir exists
+        QDir outDir(outDirPath);
+        if (!outDir.exists()) {
+            StageTimer timer("mkpath", dev->slug());
+            if (!outDir.mkpath(".")) {
+                StateParm parm = QString("Failed to create dir:\n%1").arg(outDir.path());
+                dev->setState(UsbDevice::Error, parm);
+                return;
             }
+        }
 
-            // Notify gui
-            invokeOnMainThread([removeOriginals, dev, totalFiles, copiedFiles, totalKbs, copiedKbs, kbps] {
-                CopyStats stats{removeOriginals, totalKbs, copiedKbs, totalFiles, copiedFiles, kbps};
-                QVariant v;
-                v.setValue(stats);
-                dev->setState(UsbDevice::Copy, v);
-            });
+        const auto index = dedupIndex(destPath);
+        index->build();
 
-            // Construct a nice path to dump to
-            auto camSlug = qSlugify(dev->name());
-            auto outDirPath = destPath + '/' + camSlug;
+        TransferPipeline pipeline(session, outDirPath, removeOriginals);
+        pipeline.setDeviceName(dev->slug());
+        pipeline.setCameraIdentity(identity);
+        pipeline.setDedupIndex(index);
 
-            // Make sure dest dir exists
-            QDir outDir(outDirPath);
-            if (!outDir.exists()) {
-                if (!outDir.mkpath(".")) {
-                    StateParm parm = QString("Failed to create dir:\n%1").arg(outDir.path());
-                    dev->setState(UsbDevice::Error, parm);
-                    return;
-                }
-            }
-            auto filePath = usbFile.filePath();
-
-            // Copy!
-            auto copyOutErr = runCmd({"gphoto2", "--get-file", filePath, "--port", portPath}, outDirPath);
-            if (copyOutErr.hasError()) {
-                invokeOnMainThread([dev, copyOutErr] {
-                    dev->setState(UsbDevice::Done, copyOutErr.err);
-                });
-                return;
-            }
-            // verify destination file
-            const auto filename = QFileInfo(usbFile.filePath()).fileName();
-            const auto outFilePath = outDirPath + '/' + filename;
-            if (!QFileInfo::exists(outFilePath)) {
-                invokeOnMainThread([dev, outFilePath] {
-                    dev->setState(UsbDevice::Error, "File not copied");
-                });
-                return;
+        // A backup drive that isn't there doesn't hold up the import to the primary
+        QStringList mirrorErrors;
+        for (const auto& mirrorPath: mirrorPaths) {
+            const auto mirrorDirPath = mirrorPath + '/' + dev->slug();
+            if (!QDir(mirrorDirPath).exists() && !QDir().mkpath(mirrorDirPath)) {
+                mirrorErrors << QString("Backup to %1 failed: could not create dir").arg(mirrorPath);
+                continue;
             }
+            const auto mirrorIndex = dedupIndex(mirrorPath);
+            mirrorIndex->build();
+            pipeline.addMirror(mirrorDirPath, mirrorIndex);
+        }
+        pipeline.setProgressCallback(notifyProgress);
+        pipeline.setFileDoneCallback([this, bus, port](const QString& cameraPath, const bool removed) {
+            invokeOnMainThread([this, bus, port, removed, cameraPath] {
+                if (const auto d = device(bus, port))
+                    d->markImported(cameraPath, removed);
+            });
+        });
+        // Originals go after the whole set is verified, unless asked to free up the card along the way
+        pipeline.setDeleteBatchSize(qEnvironmentVariableIntValue("CAMWATCHER_DELETE_BATCH"));
+        pipeline.setCancelToken(cancel);
+        pipeline.setBusLane(mScheduler.lane(bus, port));
+
+        TransferPipeline::Result result;
+        {
+            StageTimer timer("import", dev->slug());
+            result = pipeline.run(usbFiles);
+        }
+        invokeOnMainThread([this, bus, port] {
+            if (const auto d = device(bus, port))
+                d->finishImport();
+        });
 
-            // Delete original if requested
-            if (removeOriginals) {
-                qDebug() << usbFile.filePath();
-                auto camPath = QFileInfo(usbFile.filePath()).dir().path();
-                auto remOutErr = runCmd({"gphoto2", "--delete-file", filePath, "--port", portPath}, outDirPath);
-                if (remOutErr.hasError()) {
-                    invokeOnMainThread([dev, remOutErr] {
-                        dev->setState(UsbDevice::Error, remOutErr.err);
-                    });
-                    return;
-                }
+        if (!result.error.isEmpty()) {
+            const auto errState = result.readError ? UsbDevice::Done : UsbDevice::Error;
+            invokeOnMainThread([dev, result, errState] {
+                dev->setState(errState, result.error);
+            });
+            return;
+        }
+        // Counted on the primary, a failed backup doesn't undo what made it there
+        const int copiedFiles = result.copiedFiles - result.skippedFiles;
+        const int skippedFiles = result.skippedFiles;
+        auto mirrorResults = mirrorErrors;
+        for (int i = 1; i < result.destinations.size(); i++) {
+            const auto& mirror = result.destinations[i];
+            if (mirror.error.isEmpty()) {
+                mirrorResults << QString("Backup to %1: %2 files")
+                                         .arg(mirror.outDirPath, QString::number(mirror.copiedFiles));
+            } else {
+                mirrorResults << QString("Backup to %1 failed after %2 files: %3")
+                                         .arg(mirror.outDirPath, QString::number(mirror.copiedFiles), mirror.error);
             }
-
-            copiedKbs += usbFile.kbSize();
-            copiedFiles++;
         }
+        // Originals a backup is missing, or whose copy couldn't be verified, stay on the camera
+        const int keptFiles = removeOriginals ? result.copiedFiles - result.removedFiles : 0;
 
-        const auto secondsElapsed = QDateTime::currentSecsSinceEpoch() - copyStartTime;
+        const auto elapsed = std::chrono::steady_clock::now() - copyStartTime;
+        const auto secondsElapsed = std::chrono::duration_cast<std::chrono::seconds>(elapsed).count();
         const auto timeTaken = QDateTime::fromTime_t(secondsElapsed).toUTC().toString("hh:mm:ss");
 
-        invokeOnMainThread([this, dev, copiedFiles, timeTaken] {
-            const auto msg = QString("Done! Copied %1 files. Took %2").arg(copiedFiles).arg(timeTaken);
+        // For comparing runs, eg: against the mock camera
+        const double seconds = qMax(std::chrono::duration<double>(elapsed).count(), 0.001);
+        const double mb = static_cast<double>(result.transferredBytes) / 1e6;
+        qInfo("Imported %d files (%d skipped), %.1f MB in %.2f s: %.1f files/s, %.1f MB/s", copiedFiles, skippedFiles,
+              mb, seconds, copiedFiles / seconds, mb / seconds);
+
+        const bool cancelled = result.cancelled;
+        invokeOnMainThread([dev, copiedFiles, skippedFiles, timeTaken, mirrorResults, keptFiles, cancelled] {
+            auto msg = QString("%1 Copied %2 files. Took %3")
+                               .arg(cancelled ? "Cancelled." : "Done!")
+                               .arg(copiedFiles)
+                               .arg(timeTaken);
+            if (skippedFiles)
+                msg += QString("\nSkipped %1 already imported").arg(skippedFiles);
+            for (const auto& line: mirrorResults) msg += '\n' + line;
+            if (keptFiles)
+                msg += QString("\nKept %1 originals on the camera").arg(keptFiles);
             dev->setState(UsbDevice::Done, msg);
         });
+    };
+
+    // Queued behind a listing that is still going, they would fight over the device
+    mScheduler.run(strand(usbDevice), TransferScheduler::Priority::Bulk, [this, download, dev, cancel] {
+        download();
+        // After every state change the import posted
+        invokeOnMainThread([this, dev, cancel] {
+            // Only this import's, another one may be queued on the device
+            auto& cancels = mImportCancels[dev];
+            cancels.removeOne(cancel);
+            if (cancels.isEmpty())
+                mImportCancels.remove(dev);
+            endJob(dev);
+            if (const auto err = Metrics::instance().dump(); !err.isEmpty())
+                qWarning() << err;
+        });
     });
+}
 
-    connect(thread, &QThread::finished, [thread] {
-        thread->deleteLater();
-    });
-
-    thread->start(QThread::LowPriority);
+std::shared_ptr<DedupIndex> UsbManager::dedupIndex(const QString& destPath) {
+    std::lock_guard lock(mDedupIndexesMutex);
+    auto& index = mDedupIndexes[destPath];
+    if (!index)
+        index = std::make_shared<DedupIndex>(destPath);
+    return index;
 }
 
 void UsbManager::cancelDownload(UsbDevice& dev) {
+    // Every import on the device, queued ones too. The file in flight stops as well, the import reports back once
+    // the partial file is cleaned up.
+    for (const auto& cancel: mImportCancels.value(&dev)) cancel.cancel();
     dev.setState(UsbDevice::Cancel);
 }
 
 void UsbManager::listenForEvents() {
-    connect(&mDetectProcess, &QProcess::readyReadStandardOutput, [this] {
-        static const QSet<QString> interestingActions{"bind", "unbind"};
-        static const QRegularExpression reEvent(R"(KERNEL\[[^\]]+\]\W(\w+)\W+(/.+)(\(\w+)\))");
-        static const QRegExp reSplit("[\r\n]");
-        const QString out = mDetectProcess.readAllStandardOutput();
-        for (const auto& s: out.split(reSplit, Qt::SkipEmptyParts)) {
-            auto match = reEvent.match(s);
-            if (!match.hasMatch())
-                continue;
-            const auto action = match.captured(1);
-            if (interestingActions.contains(action)) {
-                refreshDevices();
-            }
-        }
-    });
-
-    connect(&mDetectProcess, &QProcess::readyReadStandardError, [this] {
-        static const QRegExp re("[\r\n]");
-        const QString out = mDetectProcess.readAllStandardError();
-        for (const auto& s: out.split(re, Qt::SkipEmptyParts)) {
-            qInfo() << "[STDERR]" << s;
-        }
+    mBackend->watchEvents([this](const QVector<UsbEvent>& events) {
+        invokeOnMainThread([this, events] { handleUsbEvents(events); });
     });
-
-    mDetectProcess.start("udevadm", {"monitor", "--kernel", "--subsystem-match=usb/usb_device"});
+    connect(&mUdevMonitor, &UdevMonitor::devicesChanged, this, &UsbManager::handleUsbEvents);
+    if (const auto err = mUdevMonitor.start(); !err.isEmpty())
+        qWarning() << err << "- cameras plugged in later will not show up";
 }
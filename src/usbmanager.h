@@ -1,11 +1,16 @@
 #pragma once
+#include "camerabackend.h"
+#include "canceltoken.h"
+#include "dedupindex.h"
+#include "transferscheduler.h"
+#include "udevmonitor.h"
 #include "usbdevice.h"
 
-#include <QProcess>
+#include <QHash>
+#include <QMap>
+#include <QSet>
 #include <memory>
-
-#include <QRegularExpression>
-#include <QThread>
+#include <mutex>
 
 namespace CamWatcher {
 
@@ -16,32 +21,72 @@ namespace CamWatcher {
         int totalFiles;
         int copiedFiles;
         int kbps;
+        // -1 when unknown
+        int secondsRemaining;
     };
 
     class UsbManager final : public QObject {
         Q_OBJECT
     public:
-        UsbManager();
+        // The backend selected by the environment, unless one is given
+        explicit UsbManager(std::unique_ptr<CameraBackend> backend = CameraBackend::create());
         ~UsbManager() override;
 
+        // Look for cameras in the background, found ones are added and last known ones that are gone removed
         void refreshDevices();
         [[nodiscard]] const std::vector<std::unique_ptr<UsbDevice>>& devices() const;
         [[nodiscard]] UsbDevice* device(int bus, int port) const;
         [[nodiscard]] int deviceCount() const;
         void listFiles(UsbDevice& dev);
-        void downloadFiles(UsbDevice& usbDevice, bool removeOriginals);
+        // Only the files not imported yet, unless asked to import them all again
+        void downloadFiles(UsbDevice& usbDevice, bool removeOriginals, bool reimport = false);
         void cancelDownload(UsbDevice& dev);
+        [[nodiscard]] CameraBackend& backend() const;
+        // Camera traffic on this device's USB link should hold a slot on it
+        [[nodiscard]] std::shared_ptr<BusLane> busLane(int bus, int port);
 
     Q_SIGNALS:
         void deviceAdded(UsbDevice* dev);
         void deviceRemoved();
         void deviceAboutToBeRemoved(UsbDevice* dev);
+        // The files on the device are known, after it was added or refreshed
+        void deviceListed(UsbDevice* dev);
 
     private:
+        // A detected camera with its catalog, both looked up off the gui thread
+        struct FoundCamera {
+            DetectedCamera camera;
+            std::shared_ptr<ImportCatalog> catalog;
+        };
+        static FoundCamera findCatalog(const DetectedCamera& camera);
+
         void listenForEvents();
+        void applyDetectedCameras(const QVector<FoundCamera>& cameras, const QString& err);
+        void handleUsbEvents(const QVector<UsbEvent>& events);
+        // A probing device is only known from last time, it waits for detection to confirm it's still there
+        void addDevice(const DetectedCamera& camera, ImportCatalog catalog, bool probing = false);
+        void removeDevice(UsbDevice* dev);
+        // The devices from the last run, so the gui has something to show before detection is done
+        void restoreKnownDevices();
+        void saveKnownDevices() const;
+        // While a job runs on a device, the device outlives its unplugging
+        void beginJob(UsbDevice* dev);
+        void endJob(UsbDevice* dev);
+        // What already sits in a destination directory, shared by all cameras importing there
+        std::shared_ptr<DedupIndex> dedupIndex(const QString& destPath);
 
+        std::unique_ptr<CameraBackend> mBackend;
+        TransferScheduler mScheduler;
+        QMap<QString, std::shared_ptr<DedupIndex>> mDedupIndexes;
+        std::mutex mDedupIndexesMutex;
         std::vector<std::unique_ptr<UsbDevice>> mDevices;
-        QProcess mDetectProcess;
+        QSet<UsbDevice*> mProbing;
+        // Unplugged while a job was running, kept until the last one is over
+        std::vector<std::unique_ptr<UsbDevice>> mUnplugged;
+        QHash<UsbDevice*, int> mJobs;
+        // Of the imports running or queued, to stop them mid-file. One per import, a device can have several queued.
+        QHash<UsbDevice*, QVector<CancelToken>> mImportCancels;
+        UdevMonitor mUdevMonitor;
     };
 
 }
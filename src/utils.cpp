@@ -1,51 +1,119 @@
 #include "utils.h"
 
 #include <QtDebug>
-#include <QApplication>
+#include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QProcess>
-#include <QTimer>
 #include <QString>
 
+#include "mainthreadqueue.h"
+#include "metrics.h"
 #include "slugify.hpp"
 
+namespace {
+    // How often a running command checks its deadlines and for cancellation
+    constexpr int cmdPollIntervalMs = 20;
+    // The tail of stderr kept for the error message
+    constexpr int maxErrOutputBytes = 16 * 1024;
+}
+
 void CamWatcher::invokeOnMainThread(std::function<void()> func) {
-    // any thread
-    const auto timer = new QTimer();
-    timer->moveToThread(qApp->thread());
-    timer->setSingleShot(true);
-    QObject::connect(timer, &QTimer::timeout, [=]() {
-        // main thread
-        func();
-        timer->deleteLater();
-    });
-    QMetaObject::invokeMethod(timer, "start", Qt::QueuedConnection, Q_ARG(int, 0));
+    MainThreadQueue::instance().post(nullptr, std::move(func));
+}
+
+void CamWatcher::invokeOnMainThread(const void* coalesceKey, std::function<void()> func) {
+    MainThreadQueue::instance().post(coalesceKey, std::move(func));
 }
 
 QString CamWatcher::qSlugify(const QString& text) {
-    const auto str = text.toStdString();
-    const auto slug = slugify(str);
+    const auto utf8 = text.toUtf8();
+    const auto slug = slugify(std::string_view(utf8.constData(), utf8.size()));
     return QString::fromStdString(slug);
 }
 
-CamWatcher::ProcOutput CamWatcher::runCmd(QStringList cmd, const QString& cwd) {
-    const auto proc = new QProcess();
-    proc->setWorkingDirectory(cwd);
+CamWatcher::ProcOutput CamWatcher::runCmd(QStringList cmd, const CmdOptions& options) {
+    QByteArray out;
+    const auto collect = [&out](const QByteArray& chunk) {
+        out += chunk;
+        return true;
+    };
+    auto output = streamCmd(std::move(cmd), collect, options);
+    output.out = QString::fromUtf8(out);
+    return output;
+}
+
+CamWatcher::ProcOutput CamWatcher::streamCmd(QStringList cmd, const std::function<bool(const QByteArray&)>& onOutput,
+                                             const CmdOptions& options) {
+    StageTimer timer("cmd");
+    QProcess proc;
+    proc.setWorkingDirectory(options.cwd);
     qInfo() << "Run Cmd:" << cmd.join(' ');
-    auto exe = cmd.takeFirst();
-    proc->start(exe, cmd);
-    proc->waitForFinished();
+    const auto exe = cmd.takeFirst();
+    {
+        StageTimer spawnTimer("spawn");
+        proc.start(exe, cmd);
+        if (!proc.waitForStarted())
+            return {{}, proc.errorString()};
+    }
+
+    QElapsedTimer running;
+    running.start();
+    QElapsedTimer quiet;
+    quiet.start();
+    QByteArray errOutput;
+
+    const auto stop = [&proc](const QString& reason) -> ProcOutput {
+        proc.kill();
+        proc.waitForFinished();
+        return {{}, reason};
+    };
+
+    // Wake up regularly instead of blocking on output, so deadlines and cancellation are noticed in time
+    while (proc.state() != QProcess::NotRunning || proc.bytesAvailable()) {
+        if (options.cancel.isCancelled())
+            return stop("Cancelled: " + exe);
+        if (options.timeoutMs > 0 && running.hasExpired(options.timeoutMs))
+            return stop(QString("%1 timed out after %2 ms").arg(exe).arg(options.timeoutMs));
+        if (options.stallTimeoutMs > 0 && quiet.hasExpired(options.stallTimeoutMs))
+            return stop(QString("%1 stalled, no output for %2 ms").arg(exe).arg(options.stallTimeoutMs));
+
+        proc.waitForReadyRead(cmdPollIntervalMs);
+        const auto errChunk = proc.readAllStandardError();
+        const auto chunk = proc.readAllStandardOutput();
+        if (!errChunk.isEmpty() || !chunk.isEmpty())
+            quiet.restart();
+        if (!errChunk.isEmpty())
+            errOutput = (errOutput + errChunk).right(maxErrOutputBytes);
+        if (!chunk.isEmpty() && !onOutput(chunk))
+            return stop("Aborted: " + exe);
+    }
+    proc.waitForFinished();
+    errOutput = (errOutput + proc.readAllStandardError()).right(maxErrOutputBytes);
 
     QString err;
-    if (proc->exitStatus() != QProcess::NormalExit) {
-        err = proc->readAllStandardError();
+    if (proc.exitStatus() != QProcess::NormalExit || proc.exitCode() != 0) {
+        err = QString::fromUtf8(errOutput).trimmed();
+        if (err.isEmpty())
+            err = QString("%1 exited with code %2").arg(exe).arg(proc.exitCode());
     }
+    return {{}, err};
+}
 
-    auto out = proc->readAllStandardOutput();
-    proc->close();
-    proc->deleteLater();
-    return {out, err};
+QString CamWatcher::createPortPath(const int bus, const int port) {
+    const auto busStr = QString("%1").arg(bus, 3, 10, QChar('0'));
+    const auto portStr = QString("%1").arg(port, 3, 10, QChar('0'));
+    return QString("usb:%1,%2").arg(busStr, portStr);
 }
 
-QStringList CamWatcher::splitLines(const QString& text) {
-    return text.split(QRegExp("[\r\n]"),Qt::SkipEmptyParts);
+bool CamWatcher::parsePortPath(const QString& portPath, int& bus, int& port) {
+    if (!portPath.startsWith("usb:"))
+        return false;
+    const auto parts = portPath.mid(4).split(',');
+    if (parts.size() != 2)
+        return false;
+    bool busOk = false;
+    bool portOk = false;
+    bus = parts[0].toInt(&busOk);
+    port = parts[1].toInt(&portOk);
+    return busOk && portOk;
 }
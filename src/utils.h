@@ -1,5 +1,7 @@
 #pragma once
 
+#include "canceltoken.h"
+
 #include <QPair>
 #include <QString>
 #include <functional>
@@ -16,10 +18,28 @@ namespace CamWatcher {
 
 
     void invokeOnMainThread(std::function<void()> func);
+    // Only the last call with the same key that hasn't run yet runs, eg: progress updates for one device
+    void invokeOnMainThread(const void* coalesceKey, std::function<void()> func);
     QString qSlugify(const QString& text);
 
-    ProcOutput runCmd(QStringList cmd, const QString& cwd = {});
+    struct CmdOptions {
+        // Kill the process when it runs longer than this, 0 for no limit
+        int timeoutMs = 0;
+        // Kill the process when it prints nothing for this long, 0 for no limit
+        int stallTimeoutMs = 0;
+        // Kill the process as soon as this is cancelled
+        CancelToken cancel;
+        QString cwd;
+    };
+
+    // Run a command to completion and collect its stdout. A non-zero exit code is an error, with stderr as the message.
+    ProcOutput runCmd(QStringList cmd, const CmdOptions& options = {});
+    // Like runCmd, but hands stdout to onOutput as it arrives instead of collecting it. Return false to kill the process.
+    ProcOutput streamCmd(QStringList cmd, const std::function<bool(const QByteArray&)>& onOutput,
+                         const CmdOptions& options = {});
 
-    QStringList splitLines(const QString& text);
+    // gphoto2 style port path, eg: "usb:001,005"
+    QString createPortPath(int bus, int port);
+    bool parsePortPath(const QString& portPath, int& bus, int& port);
 
 }// namespace CamWatcher
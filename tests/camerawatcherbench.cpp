@@ -0,0 +1,367 @@
+/*
+ * Benchmarks against the fake gphoto2, no camera needed:
+ *
+ *   ./CameraWatcherBench                       everything
+ *   ./CameraWatcherBench importEndToEnd        one of them
+ *
+ * The fake camera is fast by default. Like the mock backend it takes CAMWATCHER_MOCK_MBPS and
+ * CAMWATCHER_MOCK_LATENCY_MS, to see how an import does against a real camera's speed.
+ */
+
+#include "fakeudev.h"
+#include "gphotoclibackend.h"
+#include "gphotoparser.h"
+#include "mediafiles.h"
+#include "usbmanager.h"
+#include "utils.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QRegularExpression>
+#include <QSet>
+#include <QSettings>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QtTest>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace CamWatcher;
+
+namespace {
+
+    // The card the fake gphoto2 simulates
+    constexpr int fakeBus = 999;
+    constexpr int fakePort = 1;
+    constexpr int listedFiles = 20000;
+    constexpr int importedFiles = 200;
+    constexpr int importedKb = 1024;
+    // Reads fail from this file on, until the camera comes back
+    constexpr int unplugAfterFiles = 80;
+    constexpr int replugMs = 500;
+    constexpr int timeoutMs = 5 * 60 * 1000;
+
+    constexpr int postedFunctions = 100000;
+    constexpr int postingThreads = 4;
+
+    enum class Dispatch { Queue, QueueCoalesced, Timer };
+    enum class Parser { Regex, Bytes };
+
+    constexpr int parsedLines = 100000;
+    constexpr int filesPerFolder = 9999;
+
+    // How invokeOnMainThread used to do it: a QTimer per call, moved to the main thread
+    void invokeWithTimer(std::function<void()> func) {
+        const auto timer = new QTimer();
+        timer->moveToThread(qApp->thread());
+        timer->setSingleShot(true);
+        QObject::connect(timer, &QTimer::timeout, [=]() {
+            func();
+            timer->deleteLater();
+        });
+        QMetaObject::invokeMethod(timer, "start", Qt::QueuedConnection, Q_ARG(int, 0));
+    }
+
+    // A --list-files listing this many lines long, in folders of 9999 files like cameras make them
+    QByteArray listing(const int lines) {
+        QByteArray out;
+        int folder = 0;
+        int file = 0;
+        for (int i = 0; i < lines; i++) {
+            if (file == 0) {
+                out += QString("There are %1 files in folder '/store_00010001/DCIM/%2CANON'.\n")
+                               .arg(filesPerFolder)
+                               .arg(100 + folder++)
+                               .toUtf8();
+                file = 1;
+                continue;
+            }
+            out += QString("#%1     IMG_%2.%3               rd  5836 KB 6000x4000 image/jpeg 1600000000\n")
+                           .arg(file)
+                           .arg(file, 4, 10, QChar('0'))
+                           .arg(file % 10 == 0 ? "MOV" : "JPG")
+                           .toUtf8();
+            file = file == filesPerFolder ? 0 : file + 1;
+        }
+        return out;
+    }
+
+    // How listings used to be parsed: as QStrings, through regular expressions and a QSet of extensions
+    int parseWithRegex(const QByteArray& listing) {
+        static const QSet<QString> imageExtensions{"png", "jpg", "jpeg", "gif", "3fr", "ari", "arw", "bay", "braw",
+                                                   "cri", "crw", "cap", "dcs", "dng", "erf", "fff", "gpr", "jxs",
+                                                   "mef", "mdc", "mos", "mrw", "nef", "orf", "pef", "pxn", "R3D",
+                                                   "raf", "raw", "raw", "rwz", "srw", "tco", "x3f"};
+        static const QSet<QString> videoExtensions{
+                "webm", "mkv", "flv", "vob", "ogv", "ogg", "rrc", "gifv", "mng", "mov", "avi", "qt", "wmv",
+                "yuv", "rm", "asf", "amv", "mp4", "m4p", "m4v", "mpg", "mp2", "mpeg", "mpe", "mpv", "m4v",
+                "svi", "3gp", "3g2", "mxf", "roq", "nsv", "flv", "f4v", "f4p", "f4a", "f4b", "mod"};
+        static const QSet<QString> allowedExtensions = imageExtensions | videoExtensions;
+        static const QRegularExpression reFolder("There are \\d+ files in folder '([^']+)'");
+        static const QRegularExpression reFile(R"(#(\d+)\W+([\w|.]+)\W+(\w+)\W+(\d+)\W+KB\W+(.+))");
+
+        QString currentFolder;
+        QVector<UsbFile> files;
+        for (const auto& line: QString::fromUtf8(listing).split(QRegExp("[\r\n]"), Qt::SkipEmptyParts)) {
+            if (const auto folderMatch = reFolder.match(line); folderMatch.hasMatch()) {
+                currentFolder = folderMatch.captured(1);
+                continue;
+            }
+            if (const auto fileMatch = reFile.match(line); fileMatch.hasMatch()) {
+                const auto fileName = fileMatch.captured(2);
+                if (!allowedExtensions.contains(QFileInfo(fileName).suffix().toLower()))
+                    continue;
+                files.append({currentFolder + '/' + fileName, fileMatch.captured(4).toInt(), 0});
+            }
+        }
+        return files.size();
+    }
+
+    // The same with the byte level parsers, as the command line backend does it
+    int parseBytes(const QByteArray& listing) {
+        QByteArray currentFolder;
+        QVector<UsbFile> files;
+        forEachLine({listing.constData(), static_cast<size_t>(listing.size())}, [&](const std::string_view line) {
+            if (const auto folder = parseFolderLine(line)) {
+                currentFolder = QByteArray(folder->data(), static_cast<int>(folder->size())) + '/';
+                return;
+            }
+            if (const auto file = parseFileLine(line); file && isMediaFile(file->name)) {
+                auto filePath = QString::fromUtf8(currentFolder);
+                filePath += QString::fromUtf8(file->name.data(), static_cast<int>(file->name.size()));
+                files.append({filePath, file->kbSize, file->timestamp});
+            }
+        });
+        return files.size();
+    }
+
+}
+
+Q_DECLARE_METATYPE(Dispatch)
+Q_DECLARE_METATYPE(Parser)
+
+class CameraWatcherBench final : public QObject {
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void listFilesCli();
+    void parseListing_data();
+    void parseListing();
+    void slugifyNames();
+    void invokeOnMainThreadBurst_data();
+    void invokeOnMainThreadBurst();
+    void importEndToEnd();
+    void importAcrossUnplug();
+
+private:
+    static std::unique_ptr<CameraBackend> fakeBackend();
+    // The fake camera once it is listed, null if it never is
+    static UsbDevice* waitForListed(UsbManager& manager, QSignalSpy& listed);
+    // Import everything on the device into destPath, true once it is done
+    static bool importAll(UsbDevice* dev, const QString& destPath);
+    // Imported files, not the journal and manifest next to them
+    static int filesIn(const QString& dirPath);
+
+    QTemporaryDir mTempDir;
+    QString mTestDirPath;
+};
+
+void CameraWatcherBench::initTestCase() {
+    QVERIFY(mTempDir.isValid());
+    // The fake gphoto2 goes first, and nothing this runs should touch the user's settings or catalogs
+    qputenv("PATH", QByteArray(FAKE_GPHOTO2_DIR) + ':' + qgetenv("PATH"));
+    qputenv("CAMWATCHER_BACKEND", "cli");
+    QSettings::setPath(QSettings::NativeFormat, QSettings::UserScope, mTempDir.path() + "/config");
+    QCoreApplication::setOrganizationName("CoreSmith");
+    QCoreApplication::setApplicationName("CameraWatcherBench");
+}
+
+void CameraWatcherBench::init() {
+    // Every test starts with a fresh card, and a camera that was never seen before
+    mTestDirPath = mTempDir.path() + '/' + QTest::currentTestFunction();
+    QVERIFY(QDir().mkpath(mTestDirPath + "/camera"));
+    qputenv("CAMWATCHER_FAKE_STATE_DIR", QFile::encodeName(mTestDirPath + "/camera"));
+    qputenv("XDG_DATA_HOME", QFile::encodeName(mTestDirPath + "/data"));
+    qputenv("XDG_CACHE_HOME", QFile::encodeName(mTestDirPath + "/cache"));
+    QSettings().clear();
+
+    for (const auto name: {"CAMWATCHER_MOCK_FILES", "CAMWATCHER_MOCK_KB", "CAMWATCHER_MOCK_FAIL_EVERY",
+                           "CAMWATCHER_MOCK_UNPLUG_AFTER", "CAMWATCHER_MOCK_REPLUG_MS"})
+        qunsetenv(name);
+}
+
+void CameraWatcherBench::listFilesCli() {
+    qputenv("CAMWATCHER_MOCK_FILES", QByteArray::number(listedFiles));
+    qputenv("CAMWATCHER_MOCK_KB", "1");
+    GPhotoCliBackend backend;
+    const auto session = backend.openSession("Fake Camera", fakeBus, fakePort);
+
+    int listed = 0;
+    QBENCHMARK {
+        listed = 0;
+        const auto err = session->listFiles([&listed](const QVector<UsbFile>& files) { listed += files.size(); });
+        QVERIFY2(err.isEmpty(), qPrintable(err));
+    }
+    QCOMPARE(listed, listedFiles);
+}
+
+void CameraWatcherBench::parseListing_data() {
+    QTest::addColumn<Parser>("parser");
+
+    QTest::newRow("regex") << Parser::Regex;
+    QTest::newRow("bytes") << Parser::Bytes;
+}
+
+void CameraWatcherBench::parseListing() {
+    QFETCH(Parser, parser);
+    const auto input = listing(parsedLines);
+    // Every line but the folder ones is a file
+    const int folders = (parsedLines + filesPerFolder) / (filesPerFolder + 1);
+
+    int files = 0;
+    QBENCHMARK {
+        files = parser == Parser::Regex ? parseWithRegex(input) : parseBytes(input);
+    }
+    QCOMPARE(files, parsedLines - folders);
+}
+
+void CameraWatcherBench::slugifyNames() {
+    const QStringList names{"Canon EOS 80D", "NIKON DSC Z 6_2", "Sony ILCE-7M3", "FUJIFILM X-T4 Ünïcødé",
+                            "Фотоаппарат Зенит", "Φωτογραφική μηχανή", "  spaces   and---dashes  "};
+    QBENCHMARK {
+        for (const auto& name: names) {
+            const auto slug = qSlugify(name);
+            QVERIFY(!slug.isEmpty());
+        }
+    }
+}
+
+void CameraWatcherBench::invokeOnMainThreadBurst_data() {
+    QTest::addColumn<Dispatch>("dispatch");
+
+    QTest::newRow("queue") << Dispatch::Queue;
+    // Progress updates for one device, only the last is run
+    QTest::newRow("queue coalesced") << Dispatch::QueueCoalesced;
+    QTest::newRow("timer") << Dispatch::Timer;
+}
+
+void CameraWatcherBench::invokeOnMainThreadBurst() {
+    QFETCH(Dispatch, dispatch);
+    static const int progressKey = 0;
+
+    // Like the pipeline threads reporting progress during an import
+    QBENCHMARK {
+        std::atomic<int> ran = 0;
+        std::atomic<int> finished = 0;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < postingThreads; t++) {
+            threads.emplace_back([&ran, &finished, dispatch] {
+                const auto func = [&ran] { ran++; };
+                for (int i = 0; i < postedFunctions / postingThreads; i++) {
+                    if (dispatch == Dispatch::Timer)
+                        invokeWithTimer(func);
+                    else if (dispatch == Dispatch::QueueCoalesced)
+                        invokeOnMainThread(&progressKey, func);
+                    else
+                        invokeOnMainThread(func);
+                }
+                // Runs once everything this thread posted has
+                const auto finish = [&finished] { finished++; };
+                dispatch == Dispatch::Timer ? invokeWithTimer(finish) : invokeOnMainThread(finish);
+            });
+        }
+        for (auto& thread: threads) thread.join();
+        const int expected = dispatch == Dispatch::QueueCoalesced ? 1 : postedFunctions;
+        while (finished < postingThreads || ran < expected) QCoreApplication::processEvents();
+        // The timers delete themselves a round later
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    }
+}
+
+void CameraWatcherBench::importEndToEnd() {
+    qputenv("CAMWATCHER_MOCK_FILES", QByteArray::number(importedFiles));
+    qputenv("CAMWATCHER_MOCK_KB", QByteArray::number(importedKb));
+    UsbManager manager(fakeBackend());
+    QSignalSpy listed(&manager, &UsbManager::deviceListed);
+    const auto dev = waitForListed(manager, listed);
+    QVERIFY(dev);
+
+    const auto destPath = mTestDirPath + "/import";
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(importAll(dev, destPath));
+    const double seconds = qMax(timer.nsecsElapsed() / 1e9, 1e-3);
+
+    QCOMPARE(filesIn(destPath + '/' + dev->slug()), importedFiles);
+    const double bytes = static_cast<double>(importedFiles) * importedKb * 1024;
+    qInfo("%d files in %.2f s: %.1f files/s, %.1f MB/s", importedFiles, seconds, importedFiles / seconds,
+          bytes / 1e6 / seconds);
+    QTest::setBenchmarkResult(bytes / seconds, QTest::BytesPerSecond);
+}
+
+void CameraWatcherBench::importAcrossUnplug() {
+    qputenv("CAMWATCHER_MOCK_FILES", QByteArray::number(importedFiles));
+    qputenv("CAMWATCHER_MOCK_KB", QByteArray::number(importedKb));
+    qputenv("CAMWATCHER_MOCK_UNPLUG_AFTER", QByteArray::number(unplugAfterFiles));
+    qputenv("CAMWATCHER_MOCK_REPLUG_MS", QByteArray::number(replugMs));
+    UsbManager manager(fakeBackend());
+    QSignalSpy listed(&manager, &UsbManager::deviceListed);
+    QSignalSpy removed(&manager, &UsbManager::deviceRemoved);
+    const auto dev = waitForListed(manager, listed);
+    QVERIFY(dev);
+
+    // Fails partway through, the camera goes away and comes back, and the second import picks up the rest
+    const auto destPath = mTestDirPath + "/import";
+    QElapsedTimer timer;
+    timer.start();
+    dev->setDestFilePath(destPath);
+    manager.downloadFiles(*dev, false);
+    QVERIFY(removed.wait(timeoutMs));
+    const auto replugged = waitForListed(manager, listed);
+    QVERIFY(replugged);
+    QVERIFY(importAll(replugged, destPath));
+    const double seconds = qMax(timer.nsecsElapsed() / 1e9, 1e-3);
+
+    QCOMPARE(filesIn(destPath + '/' + replugged->slug()), importedFiles);
+    qInfo("%d files across an unplug in %.2f s: %.1f files/s", importedFiles, seconds, importedFiles / seconds);
+}
+
+std::unique_ptr<CameraBackend> CameraWatcherBench::fakeBackend() {
+    return std::make_unique<FakeUdevBackend>(CameraBackend::create());
+}
+
+UsbDevice* CameraWatcherBench::waitForListed(UsbManager& manager, QSignalSpy& listed) {
+    while (listed.isEmpty()) {
+        if (!listed.wait(timeoutMs))
+            return nullptr;
+    }
+    listed.clear();
+    return manager.device(fakeBus, fakePort);
+}
+
+bool CameraWatcherBench::importAll(UsbDevice* dev, const QString& destPath) {
+    dev->setDestFilePath(destPath);
+    QSignalSpy stateChanged(dev, &UsbDevice::stateChanged);
+    dev->usbManager().downloadFiles(*dev, false);
+    // The device goes to Done either way, an error message has no "Done!" in it
+    while (dev->state() != UsbDevice::Done && dev->state() != UsbDevice::Error) {
+        if (!stateChanged.wait(timeoutMs))
+            return false;
+    }
+    return dev->state() == UsbDevice::Done && dev->stateParm().toString().contains("Done!");
+}
+
+int CameraWatcherBench::filesIn(const QString& dirPath) {
+    return QDir(dirPath).entryList({"IMG_*"}, QDir::Files).size();
+}
+
+QTEST_GUILESS_MAIN(CameraWatcherBench)
+
+#include "camerawatcherbench.moc"
@@ -0,0 +1,299 @@
+/*
+ * Stands in for the gphoto2 command line, so the command line backend and its parsing run without a camera.
+ * Built as "gphoto2" into a directory of its own, put that first on PATH.
+ *
+ * Simulates the same card as the mock backend and takes the same settings:
+ *   CAMWATCHER_MOCK_FILES        number of files (2000)
+ *   CAMWATCHER_MOCK_KB           size of every file in KB (4096)
+ *   CAMWATCHER_MOCK_LATENCY_MS   wait before the first byte of every read
+ *   CAMWATCHER_MOCK_MBPS         read throughput, unlimited when 0
+ *   CAMWATCHER_MOCK_FAIL_EVERY   every Nth read fails with an I/O error
+ *   CAMWATCHER_MOCK_UNPLUG_AFTER the camera goes away after this many files are read
+ *   CAMWATCHER_MOCK_REPLUG_MS    and comes back this long after
+ *
+ * Deletes, read counts and unplugs last across calls, in CAMWATCHER_FAKE_STATE_DIR (a directory under /tmp if
+ * not set).
+ */
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    constexpr int bus = 999;
+    constexpr int port = 1;
+    constexpr long long timestamp = 1600000000;
+    constexpr size_t chunkSize = 1 << 20;
+    constexpr size_t writeSize = 64 * 1024;
+    constexpr auto unpluggedError = "*** Error: Could not find the requested device on the USB port ***\n";
+
+    struct Script {
+        int files = 2000;
+        int kbSize = 4096;
+        int latencyMs = 0;
+        int mbps = 0;
+        int failEvery = 0;
+        int unplugAfter = 0;
+        int replugMs = 0;
+    };
+
+    int envInt(const char* name, const int defaultValue) {
+        const char* value = std::getenv(name);
+        return value && *value ? std::atoi(value) : defaultValue;
+    }
+
+    long long nowMs() {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    std::string portPath() {
+        char path[16];
+        std::snprintf(path, sizeof(path), "usb:%03d,%03d", bus, port);
+        return path;
+    }
+
+    std::string folderOf(const int index) {
+        return "/store_00010001/DCIM/" + std::to_string(100 + index / 9999) + "MOCK";
+    }
+
+    std::string nameOf(const int index) {
+        char name[16];
+        std::snprintf(name, sizeof(name), "IMG_%04d.JPG", index % 9999 + 1);
+        return name;
+    }
+
+    // What persists between calls, one small file per value
+    class State {
+    public:
+        State() {
+            const char* dir = std::getenv("CAMWATCHER_FAKE_STATE_DIR");
+            mDir = dir && *dir ? dir : "/tmp/fake-gphoto2-" + std::to_string(::getuid());
+            ::mkdir(mDir.c_str(), 0755);
+            // Calls for one camera don't overlap, but be safe
+            mLockFd = ::open((mDir + "/lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (mLockFd >= 0)
+                ::flock(mLockFd, LOCK_EX);
+        }
+
+        ~State() {
+            if (mLockFd >= 0)
+                ::close(mLockFd);
+        }
+
+        long long number(const std::string& name) const {
+            std::ifstream in(mDir + '/' + name);
+            long long value = 0;
+            in >> value;
+            return value;
+        }
+
+        void setNumber(const std::string& name, const long long value) const {
+            std::ofstream(mDir + '/' + name) << value << '\n';
+        }
+
+        std::set<std::string> deleted() const {
+            std::set<std::string> paths;
+            std::ifstream in(mDir + "/deleted");
+            for (std::string line; std::getline(in, line);) paths.insert(line);
+            return paths;
+        }
+
+        void addDeleted(const std::string& path) const {
+            std::ofstream(mDir + "/deleted", std::ios::app) << path << '\n';
+        }
+
+    private:
+        std::string mDir;
+        int mLockFd = -1;
+    };
+
+    // Plugged in, after coming back if the script says so
+    bool plugged(const Script& script, const State& state) {
+        const auto unpluggedAt = state.number("unpluggedAt");
+        if (unpluggedAt == 0)
+            return true;
+        if (script.replugMs <= 0 || nowMs() - unpluggedAt < script.replugMs)
+            return false;
+        state.setNumber("unpluggedAt", 0);
+        state.setNumber("filesRead", 0);
+        return true;
+    }
+
+    int indexOf(const Script& script, const std::string& cameraPath) {
+        for (int i = 0; i < script.files; i++) {
+            if (folderOf(i) + '/' + nameOf(i) == cameraPath)
+                return i;
+        }
+        return -1;
+    }
+
+    // A 1 MiB pattern seeded by the path, repeated over the whole file
+    std::vector<char> content(const std::string& cameraPath) {
+        uint32_t seed = 2166136261u;
+        for (const char c: cameraPath) seed = (seed ^ static_cast<unsigned char>(c)) * 16777619u;
+        std::vector<char> buffer(chunkSize);
+        for (auto& c: buffer) {
+            seed = seed * 1664525u + 1013904223u;
+            c = static_cast<char>(seed >> 24);
+        }
+        return buffer;
+    }
+
+    int autoDetect(const Script& script, const State& state) {
+        std::printf("%-31s%s\n", "Model", "Port");
+        std::printf("----------------------------------------------------------\n");
+        if (plugged(script, state))
+            std::printf("%-31s%s\n", "Fake Camera", portPath().c_str());
+        return 0;
+    }
+
+    int listFiles(const Script& script, const State& state) {
+        const auto deleted = state.deleted();
+        std::printf("There are no files in folder '/'.\n");
+        for (int start = 0; start < script.files; start += 9999) {
+            const auto folder = folderOf(start);
+            std::vector<int> files;
+            for (int i = start; i < std::min(script.files, start + 9999); i++) {
+                if (!deleted.count(folder + '/' + nameOf(i)))
+                    files.push_back(i);
+            }
+            std::printf("There are %zu files in folder '%s'.\n", files.size(), folder.c_str());
+            for (size_t n = 0; n < files.size(); n++) {
+                std::printf("#%-5zu %-26s rd %5d KB 6000x4000 image/jpeg %lld\n", n + 1,
+                            nameOf(files[n]).c_str(), script.kbSize, timestamp + files[n]);
+            }
+        }
+        return 0;
+    }
+
+    int getFile(const Script& script, const State& state, const std::string& cameraPath) {
+        const int index = indexOf(script, cameraPath);
+        if (index < 0 || state.deleted().count(cameraPath)) {
+            std::fprintf(stderr, "*** Error: File '%s' does not exist ***\n", cameraPath.c_str());
+            return 1;
+        }
+        const auto readsStarted = state.number("readsStarted") + 1;
+        state.setNumber("readsStarted", readsStarted);
+        if (script.failEvery > 0 && readsStarted % script.failEvery == 0) {
+            std::fprintf(stderr, "*** Error (-7: 'I/O problem') ***\n");
+            return 1;
+        }
+        if (script.latencyMs > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(script.latencyMs));
+
+        const auto buffer = content(cameraPath);
+        const auto size = static_cast<size_t>(script.kbSize) * 1024;
+        const auto started = std::chrono::steady_clock::now();
+        for (size_t pos = 0; pos < size;) {
+            const auto start = pos % chunkSize;
+            const auto length = std::min(std::min(writeSize, chunkSize - start), size - pos);
+            if (std::fwrite(buffer.data() + start, 1, length, stdout) != length)
+                return 1;
+            pos += length;
+            // Hold back to the scripted MB/s (10^6 bytes, like camera specs)
+            if (script.mbps > 0)
+                std::this_thread::sleep_until(started + std::chrono::microseconds(pos / script.mbps));
+        }
+        std::fflush(stdout);
+
+        const auto filesRead = state.number("filesRead") + 1;
+        state.setNumber("filesRead", filesRead);
+        if (filesRead == script.unplugAfter)
+            state.setNumber("unpluggedAt", nowMs());
+        return 0;
+    }
+
+    int getThumbnail(const Script& script, const State& state, const std::string& cameraPath) {
+        if (indexOf(script, cameraPath) < 0 || state.deleted().count(cameraPath)) {
+            std::fprintf(stderr, "*** Error: File '%s' does not exist ***\n", cameraPath.c_str());
+            return 1;
+        }
+        std::printf("P6\n160 120\n255\n");
+        for (int i = 0; i < 160 * 120; i++) std::fwrite("\x80\x80\x80", 1, 3, stdout);
+        return 0;
+    }
+
+    int deleteFiles(const Script& script, const State& state, const std::vector<std::string>& cameraPaths) {
+        for (const auto& cameraPath: cameraPaths) {
+            if (indexOf(script, cameraPath) < 0 || state.deleted().count(cameraPath)) {
+                std::fprintf(stderr, "*** Error: File '%s' does not exist ***\n", cameraPath.c_str());
+                return 1;
+            }
+            state.addDeleted(cameraPath);
+            std::printf("Deleting file %s.\n", cameraPath.c_str());
+        }
+        return 0;
+    }
+
+}
+
+int main(const int argc, char** argv) {
+    Script script;
+    script.files = envInt("CAMWATCHER_MOCK_FILES", script.files);
+    script.kbSize = envInt("CAMWATCHER_MOCK_KB", script.kbSize);
+    script.latencyMs = envInt("CAMWATCHER_MOCK_LATENCY_MS", 0);
+    script.mbps = envInt("CAMWATCHER_MOCK_MBPS", 0);
+    script.failEvery = envInt("CAMWATCHER_MOCK_FAIL_EVERY", 0);
+    script.unplugAfter = envInt("CAMWATCHER_MOCK_UNPLUG_AFTER", 0);
+    script.replugMs = envInt("CAMWATCHER_MOCK_REPLUG_MS", 0);
+
+    // gphoto2 runs its actions in order, only the ones we use are known
+    std::string action;
+    std::string target;
+    std::string portArg;
+    std::vector<std::string> deletes;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--auto-detect" || arg == "--list-files") {
+            action = arg;
+        } else if ((arg == "--get-file" || arg == "--get-thumbnail") && hasValue) {
+            action = arg;
+            target = argv[++i];
+        } else if (arg == "--delete-file" && hasValue) {
+            action = arg;
+            deletes.emplace_back(argv[++i]);
+        } else if (arg == "--port" && hasValue) {
+            portArg = argv[++i];
+        } else if (arg.rfind("--port=", 0) == 0) {
+            portArg = arg.substr(7);
+        } else if (arg != "--stdout") {
+            std::fprintf(stderr, "*** Error: Unknown option '%s' ***\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    const State state;
+    if (action == "--auto-detect")
+        return autoDetect(script, state);
+
+    if (!plugged(script, state) || (!portArg.empty() && portArg != portPath())) {
+        std::fputs(unpluggedError, stderr);
+        return 1;
+    }
+    if (action == "--list-files")
+        return listFiles(script, state);
+    if (action == "--get-file")
+        return getFile(script, state, target);
+    if (action == "--get-thumbnail")
+        return getThumbnail(script, state, target);
+    if (action == "--delete-file")
+        return deleteFiles(script, state, deletes);
+
+    std::fprintf(stderr, "*** Error: No action given ***\n");
+    return 1;
+}
@@ -0,0 +1,66 @@
+#include "fakeudev.h"
+
+#include <chrono>
+
+using namespace CamWatcher;
+
+FakeUdevBackend::FakeUdevBackend(std::unique_ptr<CameraBackend> backend, const int pollMs)
+    : mBackend(std::move(backend)), mPollMs(pollMs) {}
+
+FakeUdevBackend::~FakeUdevBackend() {
+    {
+        std::lock_guard lock(mMutex);
+        mStop = true;
+    }
+    mStopChanged.notify_all();
+    if (mThread.joinable())
+        mThread.join();
+}
+
+QString FakeUdevBackend::name() const {
+    return mBackend->name();
+}
+
+QString FakeUdevBackend::detectCameras(QVector<DetectedCamera>& cameras) {
+    return mBackend->detectCameras(cameras);
+}
+
+QString FakeUdevBackend::detectCamera(const int bus, const int port, std::optional<DetectedCamera>& camera) {
+    return mBackend->detectCamera(bus, port, camera);
+}
+
+std::shared_ptr<CameraSession> FakeUdevBackend::openSession(const QString& name, const int bus, const int port) {
+    return mBackend->openSession(name, bus, port);
+}
+
+void FakeUdevBackend::watchEvents(UsbEventSink sink) {
+    mSink = std::move(sink);
+    // Whatever is there now is found by the first detect, only changes after that are events
+    QVector<DetectedCamera> cameras;
+    if (mBackend->detectCameras(cameras).isEmpty()) {
+        for (const auto& camera: cameras) mConnected.insert({camera.bus, camera.port});
+    }
+    mThread = std::thread([this] { poll(); });
+}
+
+void FakeUdevBackend::poll() {
+    std::unique_lock lock(mMutex);
+    while (!mStopChanged.wait_for(lock, std::chrono::milliseconds(mPollMs), [this] { return mStop; })) {
+        lock.unlock();
+        QVector<DetectedCamera> cameras;
+        const auto err = mBackend->detectCameras(cameras);
+        lock.lock();
+        if (!err.isEmpty())
+            continue;
+
+        QSet<QPair<int, int>> connected;
+        for (const auto& camera: cameras) connected.insert({camera.bus, camera.port});
+
+        QVector<UsbEvent> events;
+        for (const auto& [bus, port]: mConnected - connected) events.append({false, bus, port});
+        for (const auto& [bus, port]: connected - mConnected) events.append({true, bus, port});
+        mConnected = connected;
+        if (!events.isEmpty())
+            mSink(events);
+    }
+}
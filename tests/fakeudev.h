@@ -0,0 +1,42 @@
+#pragma once
+
+#include "camerabackend.h"
+
+#include <QPair>
+#include <QSet>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace CamWatcher {
+
+    /**
+     * Stands in for udev: wraps a backend and reports its cameras coming and going, found by detecting them
+     * every so often. Lets hotplugging run against the fake gphoto2, whose cameras udev never sees.
+     */
+    class FakeUdevBackend final : public CameraBackend {
+    public:
+        explicit FakeUdevBackend(std::unique_ptr<CameraBackend> backend, int pollMs = 100);
+        ~FakeUdevBackend() override;
+
+        [[nodiscard]] QString name() const override;
+        QString detectCameras(QVector<DetectedCamera>& cameras) override;
+        QString detectCamera(int bus, int port, std::optional<DetectedCamera>& camera) override;
+        std::shared_ptr<CameraSession> openSession(const QString& name, int bus, int port) override;
+        void watchEvents(UsbEventSink sink) override;
+
+    private:
+        void poll();
+
+        const std::unique_ptr<CameraBackend> mBackend;
+        const int mPollMs;
+        UsbEventSink mSink;
+        QSet<QPair<int, int>> mConnected;
+        std::thread mThread;
+        std::mutex mMutex;
+        std::condition_variable mStopChanged;
+        bool mStop = false;
+    };
+
+}
@@ -0,0 +1,131 @@
+/*
+ * slugify() against the implementation it replaced: the same output for anything without a repeated
+ * transliterated character, which the old one only replaced the first of. And how much faster it is.
+ */
+
+#include "legacyslugify.hpp"
+#include "slugify.hpp"
+
+#include <QtTest>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+    // Pieces random inputs are made of: plain ASCII, whitespace and dashes, symbols that are dropped or spelled
+    // out, transliterated letters from every table section, and characters outside the table
+    const std::vector<std::string> pieces{
+            "a", "Z", "9", " ", "  ", "\t", "\n", "-", "--", "_", ".", "*", "(", ")", "'", "\"", "#", "!", "@",
+            "/", "$", "&", "<", "|", "é", "Ü", "ß", "ẞ", "Ж", "щ", "ь", "Ω", "ς", "ı", "İ", "ł", "ž", "ā", "€",
+            "♥", "∑", "😀", "中", "\xff", "\xc3", "\xe2\x82"};
+    constexpr int randomInputs = 20000;
+    constexpr int maxPieces = 10;
+
+    // Pieces in the table show up at most once, the old implementation only replaced the first one
+    bool inTable(const std::string& piece) {
+        for (const auto& entry: slugify_detail::slugifyEntries) {
+            if (entry.from == piece)
+                return true;
+        }
+        return false;
+    }
+
+    const QStringList cameraNames{"Canon EOS 80D", "NIKON DSC Z 6_2", "Sony ILCE-7M3", "FUJIFILM X-T4",
+                                  "Фотоаппарат Зенит", "Φωτογραφική μηχανή", "Appareil photo d'été", "  GoPro  HERO9 "};
+
+}
+
+class SlugifyTest final : public QObject {
+    Q_OBJECT
+private Q_SLOTS:
+    void sameAsLegacy_data();
+    void sameAsLegacy();
+    void everyEntrySameAsLegacy();
+    void randomSameAsLegacy();
+    void replacesEveryOccurrence();
+
+    void benchmark_data();
+    void benchmark();
+};
+
+void SlugifyTest::sameAsLegacy_data() {
+    QTest::addColumn<QByteArray>("input");
+
+    QTest::newRow("empty") << QByteArray("");
+    QTest::newRow("ascii") << QByteArray("Canon EOS 80D");
+    QTest::newRow("trimmed") << QByteArray("  \tNikon Z 6  \n");
+    QTest::newRow("runs") << QByteArray("a - b -- c\t\t-d");
+    QTest::newRow("leading dash") << QByteArray("-leading");
+    QTest::newRow("trailing dash") << QByteArray("trailing-");
+    QTest::newRow("dropped symbols") << QByteArray("a!b@c#d%e^f");
+    QTest::newRow("kept symbols") << QByteArray("a_b.c(d)e'f\"g*h+i~j");
+    QTest::newRow("spelled out") << QByteArray("Tom & Jerry <3 $ | x");
+    QTest::newRow("latin") << QByteArray("Café d'Ñandú À Ø");
+    QTest::newRow("german") << QByteArray("Größe");
+    QTest::newRow("greek") << QByteArray("Φωτογραφική");
+    QTest::newRow("russian") << QByteArray("Зенит ФЭД");
+    QTest::newRow("ukrainian") << QByteArray("Їжак Ґуля");
+    QTest::newRow("outside the table") << QByteArray("中文 😀 camera");
+    QTest::newRow("invalid utf-8") << QByteArray("a\xff b\xe2\x82 c\xc3");
+    QTest::newRow("only dropped") << QByteArray("!!!");
+}
+
+void SlugifyTest::sameAsLegacy() {
+    QFETCH(QByteArray, input);
+    const auto utf8 = input.toStdString();
+    QCOMPARE(QString::fromStdString(slugify(utf8)), QString::fromStdString(legacySlugify(utf8)));
+}
+
+void SlugifyTest::everyEntrySameAsLegacy() {
+    for (const auto& entry: slugify_detail::slugifyEntries) {
+        const auto input = "x " + std::string(entry.from) + "-y";
+        QCOMPARE(QString::fromStdString(slugify(input)), QString::fromStdString(legacySlugify(input)));
+    }
+}
+
+void SlugifyTest::randomSameAsLegacy() {
+    std::mt19937 rng(1);
+    for (int n = 0; n < randomInputs; n++) {
+        std::string input;
+        std::set<std::string> used;
+        const auto count = rng() % maxPieces;
+        for (size_t i = 0; i < count; i++) {
+            const auto& piece = pieces[rng() % pieces.size()];
+            if (inTable(piece) && !used.insert(piece).second)
+                continue;
+            input += piece;
+        }
+        QCOMPARE(QString::fromStdString(slugify(input)), QString::fromStdString(legacySlugify(input)));
+    }
+}
+
+void SlugifyTest::replacesEveryOccurrence() {
+    QCOMPARE(QString::fromStdString(slugify("Фотоаппарат")), QString("Fotoapparat"));
+    QCOMPARE(QString::fromStdString(slugify("Éé été")), QString("Ee-ete"));
+    QCOMPARE(QString::fromStdString(slugify("$$")), QString("dollardollar"));
+}
+
+void SlugifyTest::benchmark_data() {
+    QTest::addColumn<bool>("legacy");
+
+    QTest::newRow("legacy") << true;
+    QTest::newRow("table") << false;
+}
+
+void SlugifyTest::benchmark() {
+    QFETCH(bool, legacy);
+    std::vector<std::string> names;
+    for (const auto& name: cameraNames) names.push_back(name.toStdString());
+
+    size_t length = 0;
+    QBENCHMARK {
+        for (const auto& name: names) length += legacy ? legacySlugify(name).size() : slugify(name).size();
+    }
+    QVERIFY(length > 0);
+}
+
+QTEST_APPLESS_MAIN(SlugifyTest)
+
+#include "slugifytest.moc"